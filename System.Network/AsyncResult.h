@@ -0,0 +1,386 @@
+#pragma once
+#include "NetworkImpl.h"
+#include "BufferPool.h"
+#include "Threading.h"
+#include "TimerWheel.h"
+#include <sys/uio.h>
+
+//array of the slices or accepted descriptors of a result, small ones are held inline, ones up to
+//PooledBytes are taken from a pool and only larger ones from the heap
+struct ResultArray
+{
+	enum { InlineBytes = 128, PooledBytes = 1024 };
+
+	uint8*	data;
+	size_t	bytes;
+	union
+	{
+		uint8	inlineData[InlineBytes];
+		uint64	align;
+	};
+
+	ResultArray() : data(0x0), bytes(0) { }
+	~ResultArray()	{ Free(); }
+
+	static BufferPool& Pool()
+	{
+		//never destroyed, results may still be released while statics are torn down
+		static BufferPool* pool = new BufferPool(PooledBytes, 64, false);
+		return *pool;
+	}
+
+	void* Reserve(size_t size)
+	{
+		Free();
+		if( size <= InlineBytes )
+			data = inlineData;
+		else if( size <= PooledBytes )
+			data = Pool().Acquire();
+		else
+			data = new uint8[size];
+		bytes = size;
+		return data;
+	}
+
+	void Free()
+	{
+		if( bytes > PooledBytes )
+			delete[] data;
+		else if( bytes > InlineBytes )
+			Pool().Release(data);
+		data = 0x0;
+		bytes = 0;
+	}
+
+private:
+	ResultArray(const ResultArray&);
+	ResultArray& operator=(const ResultArray&);
+};
+
+//IAsyncResult shared by the SocketIOManager implementations, recycled through a pool
+//so the steady-state send and receive path does not touch the heap
+struct SocketAsyncResult : IAsyncResult, Pooled<SocketAsyncResult>
+{
+	SocketIOManager& manager;
+	SocketOperation::Enum operation;
+	AsyncCallback callback;
+	void*		state;
+	uint8*		buffer;
+	int32		size;
+	int32		transferred;
+	//scatter/gather operations leave buffer unused, size holds the total length
+	IoSlice*	slices;
+	int32		sliceCount;
+	//first slice that is not completely transferred
+	int32		slice;
+	//accepted descriptors, at most size of them
+	SOCKET*		accepted;
+	int32		acceptedCount;
+	ResultArray	array;
+	//links of the queue of its socket and of the completions it is dispatched with
+	SocketAsyncResult* next;
+	SocketAsyncResult* previous;
+	SocketAsyncResult* chained;
+	sockaddr_in	endPoint;
+	//zero-copy sends complete once the kernel released the buffer
+	bool		zeroCopy;
+	//notifications the kernel still owes for zero-copy sends, and the id of the last one
+	int32		notifications;
+	unsigned	sequence;
+	int			error;
+	bool		completed;
+	//when a pending operation times out, 0 for never
+	uint64		deadline;
+	//node of a timer begun with BeginTimer in the wheel of its loop
+	TimerWheel::Timer timer;
+	//when an accept or connect began, in nanoseconds
+	uint64		started;
+	Mutex		mutex;
+	Condition	condition;
+
+	SocketAsyncResult(SocketIOManager& m, SocketOperation::Enum o, uint8* b, int32 s, AsyncCallback c, void* st)
+		: manager(m), operation(o), callback(c), state(st), buffer(b), size(s), transferred(0), slices(0x0), sliceCount(0), slice(0), accepted(0x0), acceptedCount(0), next(0x0), previous(0x0), chained(0x0), zeroCopy(false), notifications(0), sequence(0), error(0), completed(false), deadline(0),
+		  started(o == SocketOperation::Accept || o == SocketOperation::Connect ? Nanoseconds() : 0) { }
+
+	SocketIOManager& Manager()	{ return manager; }
+	void* AsyncState()			{ return state; }
+	bool IsCompleted()
+	{
+		ScopedLock lock(mutex);
+		return completed;
+	}
+
+	//marks the result completed, the callback is invoked once no manager lock is held
+	void Complete(int errorCode)
+	{
+		ScopedLock lock(mutex);
+		error = errorCode;
+		completed = true;
+		condition.Broadcast();
+	}
+
+	void Gather(const IoSlice* s, int32 count)
+	{
+		slices = reinterpret_cast<IoSlice*>(array.Reserve(count * sizeof(IoSlice)));
+		sliceCount = count;
+		size = 0;
+		for( int32 i = 0; i < count; i++ ) {
+			slices[i] = s[i];
+			size += (int32)s[i].size;
+		}
+	}
+
+	void Reserve(int32 capacity)
+	{
+		accepted = reinterpret_cast<SOCKET*>(array.Reserve(capacity * sizeof(SOCKET)));
+	}
+
+	iovec* Pending()	{ return reinterpret_cast<iovec*>(&slices[slice]); }
+	size_t PendingCount()	{ return sliceCount - slice; }
+
+	//accounts for bytes transferred, moving the slices past them
+	void Advance(int32 length)
+	{
+		transferred += length;
+		while( length > 0 && slice < sliceCount ) {
+			IoSlice& current = slices[slice];
+			if( (size_t)length < current.size ) {
+				current.buffer += length;
+				current.size -= length;
+				return;
+			}
+			length -= (int32)current.size;
+			slice++;
+		}
+	}
+
+	//copies received bytes into the buffer or slices, returns the number of bytes taken
+	int32 Fill(const uint8* data, int32 length)
+	{
+		if( length > size - transferred )
+			length = size - transferred;
+		if( sliceCount == 0 ) {
+			memcpy(buffer + transferred, data, length);
+			Advance(length);
+			return length;
+		}
+
+		int32 copied = 0;
+		while( copied < length ) {
+			IoSlice& current = slices[slice];
+			int32 part = (size_t)(length - copied) < current.size ? length - copied : (int32)current.size;
+			memcpy(current.buffer, data + copied, part);
+			copied += part;
+			Advance(part);
+		}
+		return copied;
+	}
+
+	void Invoke()
+	{
+		if( callback != 0x0 )
+			callback(this);
+	}
+
+	void Wait()
+	{
+		ScopedLock lock(mutex);
+		while( completed == false )
+			condition.Wait(mutex);
+	}
+
+	//waits for the operation, releases the result and returns the bytes transferred
+	static int End(IAsyncResult* asyncResult)
+	{
+		SocketAsyncResult* result = static_cast<SocketAsyncResult*>(asyncResult);
+		result->Wait();
+		int error = result->error, transferred = result->transferred;
+		if( result->operation == SocketOperation::Connect && error == 0 )
+			countEstablished(SocketOperation::Connect, 1, result->started);
+		delete result;
+
+		if( error != 0 ) {
+			throw SocketException(resolveError(error));
+		}
+		return transferred;
+	}
+
+	//waits for the accept, releases the result and hands the non-blocking sockets to accepted
+	static int EndAccept(IAsyncResult* asyncResult, Socket* accepted)
+	{
+		SocketAsyncResult* result = static_cast<SocketAsyncResult*>(asyncResult);
+		result->Wait();
+		int error = result->error, count = result->acceptedCount;
+		for( int i = 0; i < count; i++ ) {
+			accepted[i].Close();
+			clearSocket(reinterpret_cast<Socket::Impl*>(&accepted[i].m_impl));
+			reinterpret_cast<Socket::Impl*>(&accepted[i].m_impl)->socket = result->accepted[i];
+			reinterpret_cast<Socket::Impl*>(&accepted[i].m_impl)->blocking = 0;
+		}
+		if( count > 0 )
+			countEstablished(SocketOperation::Accept, count, result->started);
+		delete result;
+
+		if( error != 0 ) {
+			throw SocketException(resolveError(error));
+		}
+		return count;
+	}
+};
+
+//accepts pending connections until the result is full, returns the error that stopped it,
+//the listening socket must be non-blocking
+inline int AcceptPending(SOCKET listener, SocketAsyncResult* result)
+{
+	while( result->acceptedCount < result->size ) {
+		SOCKET accepted = accept4(listener, 0x0, 0x0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if( accepted == INVALID_SOCKET ) {
+			if( errno == EINTR || errno == ECONNABORTED )
+				continue;
+			return errno;
+		}
+		result->accepted[result->acceptedCount++] = accepted;
+	}
+	return 0;
+}
+
+//pending operations of a socket in the order they were begun, linked through the results
+//so that queueing an operation does not allocate
+template<class T> struct ResultQueue
+{
+	T*	head;
+	T*	tail;
+
+	ResultQueue() : head(0x0), tail(0x0) { }
+
+	bool Empty() const	{ return head == 0x0; }
+	T*	 Front() const	{ return head; }
+	T*	 Back() const	{ return tail; }
+	static T* Next(T* result)	{ return static_cast<T*>(result->next); }
+
+	void Push(T* result)
+	{
+		result->next = 0x0;
+		result->previous = tail;
+		if( tail != 0x0 )
+			tail->next = result;
+		else
+			head = result;
+		tail = result;
+	}
+
+	//the result must be queued
+	void Remove(T* result)
+	{
+		if( result->previous != 0x0 )
+			result->previous->next = result->next;
+		else
+			head = static_cast<T*>(result->next);
+		if( result->next != 0x0 )
+			result->next->previous = result->previous;
+		else
+			tail = static_cast<T*>(result->previous);
+		result->next = result->previous = 0x0;
+	}
+
+	T* Pop()
+	{
+		T* result = head;
+		Remove(result);
+		return result;
+	}
+};
+
+//results whose callbacks are to be invoked, chained through the results themselves
+struct Completions
+{
+	SocketAsyncResult* head;
+	SocketAsyncResult* tail;
+
+	Completions() : head(0x0), tail(0x0) { }
+
+	bool Empty() const	{ return head == 0x0; }
+
+	void Push(SocketAsyncResult* result)
+	{
+		result->chained = 0x0;
+		if( tail != 0x0 )
+			tail->chained = result;
+		else
+			head = result;
+		tail = result;
+	}
+
+	//moves every result of other behind the ones held
+	void Append(Completions& other)
+	{
+		if( other.head == 0x0 )
+			return;
+		if( tail != 0x0 )
+			tail->chained = other.head;
+		else
+			head = other.head;
+		tail = other.tail;
+		other.head = other.tail = 0x0;
+	}
+
+	//0x0 once empty
+	SocketAsyncResult* Pop()
+	{
+		SocketAsyncResult* result = head;
+		if( result != 0x0 ) {
+			head = result->chained;
+			if( head == 0x0 )
+				tail = 0x0;
+		}
+		return result;
+	}
+};
+
+//timers the managers file in the wheels of their loops, the deadlines of a socket
+//cover its pending receives and accepts, its sends and connects and its idle time
+namespace TimerKind
+{
+	enum Enum
+	{
+		Receive,
+		Send,
+		Idle,
+		Expiry
+	};
+}
+
+//deadline of an operation begun at now that may stay pending for timeout milliseconds
+inline uint64 DeadlineOf(int timeout, uint64 now)
+{
+	return timeout > 0 ? now + timeout : 0;
+}
+
+inline void Complete(Completions& completions, SocketAsyncResult* result, int errorCode)
+{
+	//a result without callback may be released by its waiter as soon as it completes
+	if( result->callback != 0x0 ) {
+		completions.Push(result);
+	}
+	result->Complete(errorCode);
+}
+
+//callbacks of operations that complete inside Begin nest on the caller's stack,
+//past this depth they are handed to the event loop instead
+const int MaxInlineDepth = 16;
+
+inline int& InlineDepth()
+{
+	static THREAD_LOCAL int depth = 0;
+	return depth;
+}
+
+inline void Dispatch(Completions& completions)
+{
+	InlineDepth()++;
+	//the callback may release the result, it is unlinked first
+	SocketAsyncResult* result;
+	while( (result = completions.Pop()) != 0x0 )
+		result->Invoke();
+	InlineDepth()--;
+}
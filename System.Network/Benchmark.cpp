@@ -0,0 +1,691 @@
+#include "Benchmark.h"
+#include "SocketPoller.h"
+#include "Threading.h"
+#include <set>
+#include <vector>
+#include <stdio.h>
+
+#if PLATFORM == PLATFORM_LINUX
+#include "EpollIOManager.h"
+#include "UringIOManager.h"
+#include "Runtime.h"
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	namespace Role
+	{
+		enum Enum
+		{
+			//discards what it receives
+			Sink,
+			//sends back what it receives
+			Echo,
+			//closes connections right after accepting them
+			Hangup
+		};
+	}
+
+	const int32 ServerBuffer = 64 * 1024;
+	const int AcceptBatch = 64;
+	const int Backlog = 4096;
+	//connections bound to one loopback source address, stays below the ephemeral port range
+	const int ConnectionsPerSource = 20000;
+	//milliseconds the polling server waits before it checks whether it was stopped
+	const int PollInterval = 50;
+
+	void SendAll(Socket& socket, uint8* buffer, int32 size)
+	{
+		int32 sent = 0;
+		while( sent < size )
+			sent += socket.Send(buffer, sent, size - sent);
+	}
+
+	void ReceiveAll(Socket& socket, uint8* buffer, int32 size)
+	{
+		int32 received = 0;
+		while( received < size ) {
+			int length = socket.Receive(buffer, received, size - received);
+			if( length == 0 ) {
+				throw SocketException("The server closed the connection.");
+			}
+			received += length;
+		}
+	}
+
+	Socket Connect(const IPEndPoint& endPoint)
+	{
+		Socket socket(AdressFamilly::InterNetwork, SocketType::Stream, ProtocolType::Tcp);
+		socket.Connect(endPoint);
+		return socket;
+	}
+
+	struct Server;
+
+	struct Connection
+	{
+		Server*	server;
+		Socket	socket;
+		uint8*	buffer;
+		//the manager of the asynchronous modes, a loop of its own in the runtime mode
+		SocketIOManager* manager;
+		//the handler of the blocking mode
+		Thread	thread;
+	};
+
+	struct Server
+	{
+		BenchmarkMode::Enum	mode;
+		Role::Enum			role;
+		IPEndPoint			endPoint;
+		Socket				listener;
+		//the acceptor of the blocking mode and the loop of the polling one
+		Thread				thread;
+		//the manager of the listener, owned by the runtime in the runtime mode
+		SocketIOManager*	manager;
+		#if PLATFORM == PLATFORM_LINUX
+		Runtime*			runtime;
+		#endif
+		int					loops;
+
+		Mutex				mutex;
+		Condition			condition;
+		bool				running;
+		bool				accepting;
+		std::set<Connection*> connections;
+		//blocking handlers that ended, joined once the server stops
+		std::vector<Connection*> finished;
+
+		Server(BenchmarkMode::Enum m, Role::Enum r, int port, int l)
+			: mode(m), role(r), endPoint(IPAdress::Loopback, port), manager(0x0), loops(l), running(false), accepting(false)
+		{
+			#if PLATFORM == PLATFORM_LINUX
+			runtime = 0x0;
+			#endif
+		}
+
+		bool Running()
+		{
+			ScopedLock lock(mutex);
+			return running;
+		}
+
+		//takes the accepted socket over
+		Connection* Open(Socket& socket)
+		{
+			Connection* connection = new Connection();
+			connection->server = this;
+			connection->socket = SOCKET_MOVE(socket);
+			connection->buffer = new uint8[ServerBuffer];
+			connection->manager = manager;
+			#if PLATFORM == PLATFORM_LINUX
+			if( runtime != 0x0 )
+				connection->manager = &runtime->Assign();
+			#endif
+			ScopedLock lock(mutex);
+			connections.insert(connection);
+			return connection;
+		}
+
+		//closes under the lock so that Stop never shuts down a descriptor that was reused
+		void Close(Connection* connection)
+		{
+			ScopedLock lock(mutex);
+			connection->socket.Close();
+			connections.erase(connection);
+			delete [] connection->buffer;
+			delete connection;
+			condition.Broadcast();
+		}
+
+		//blocking mode
+
+		static void Handle(void* argument)
+		{
+			Connection* connection = reinterpret_cast<Connection*>(argument);
+			Server* server = connection->server;
+			SocketError::Enum error = SocketError::Success;
+			for( ;; ) {
+				int length = connection->socket.Receive(connection->buffer, 0, ServerBuffer, error);
+				if( length == 0 )
+					break;
+				if( server->role == Role::Echo ) {
+					for( int sent = 0; sent < length && error == SocketError::Success; )
+						sent += connection->socket.Send(connection->buffer, sent, length - sent, error);
+					if( error != SocketError::Success )
+						break;
+				}
+			}
+
+			//the thread cannot join itself, Stop does
+			ScopedLock lock(server->mutex);
+			connection->socket.Close();
+			delete [] connection->buffer;
+			server->connections.erase(connection);
+			server->finished.push_back(connection);
+			server->condition.Broadcast();
+		}
+
+		static void AcceptBlocking(void* argument)
+		{
+			Server* server = reinterpret_cast<Server*>(argument);
+			for( ;; ) {
+				Socket accepted;
+				server->listener.Accept(accepted);
+				bool running = server->Running();
+				if( running == false || server->role == Role::Hangup ) {
+					accepted.Close();
+					if( running == false )
+						break;
+					continue;
+				}
+
+				Connection* connection = server->Open(accepted);
+				if( connection->thread.Start(&Handle, connection) == false ) {
+					//the client sees the connection close, there are no more threads to serve it
+					server->Close(connection);
+				}
+			}
+		}
+
+		//polling mode
+
+		static void PollLoop(void* argument)
+		{
+			Server* server = reinterpret_cast<Server*>(argument);
+			SocketPoller poller;
+			poller.Add(server->listener, PollEvents::Read, 0x0);
+
+			SocketReadiness ready[256];
+			Socket accepted[AcceptBatch];
+			while( server->Running() == true ) {
+				int count = poller.Wait(ready, 256, PollInterval);
+				for( int i = 0; i < count; i++ ) {
+					SocketError::Enum error = SocketError::Success;
+					if( ready[i].state == 0x0 ) {
+						int accepts = server->listener.Accept(accepted, AcceptBatch, error);
+						for( int j = 0; j < accepts; j++ ) {
+							if( server->role == Role::Hangup ) {
+								accepted[j].Close();
+								continue;
+							}
+							Connection* connection = server->Open(accepted[j]);
+							poller.Add(connection->socket, PollEvents::Read, connection);
+						}
+						continue;
+					}
+
+					Connection* connection = reinterpret_cast<Connection*>(ready[i].state);
+					int length = connection->socket.Receive(connection->buffer, 0, ServerBuffer, error);
+					if( length > 0 && server->role == Role::Echo ) {
+						for( int sent = 0; sent < length && (error == SocketError::Success || error == SocketError::WouldBlock); ) {
+							if( error == SocketError::WouldBlock )
+								connection->socket.Poll(PollInterval * 1000, SelectMode::SelectWrite);
+							sent += connection->socket.Send(connection->buffer, sent, length - sent, error);
+						}
+					}
+					//the peer closed or the connection failed
+					if( error != SocketError::WouldBlock && (length == 0 || error != SocketError::Success) ) {
+						poller.Remove(connection->socket);
+						server->Close(connection);
+					}
+				}
+			}
+
+			std::vector<Connection*> remaining;
+			{
+				ScopedLock lock(server->mutex);
+				remaining.assign(server->connections.begin(), server->connections.end());
+			}
+			for( size_t i = 0; i < remaining.size(); i++ ) {
+				poller.Remove(remaining[i]->socket);
+				server->Close(remaining[i]);
+			}
+		}
+
+		//asynchronous modes
+
+		void StopAccepting()
+		{
+			ScopedLock lock(mutex);
+			accepting = false;
+			condition.Broadcast();
+		}
+
+		void BeginAccept()
+		{
+			try {
+				listener.BeginAccept(AcceptBatch, &OnAccept, this, *manager);
+			} catch( SocketException& ) {
+				StopAccepting();
+			}
+		}
+
+		void BeginReceive(Connection* connection)
+		{
+			try {
+				connection->socket.BeginReceive(connection->buffer, 0, ServerBuffer, &OnReceive, connection, *connection->manager);
+			} catch( SocketException& ) {
+				Close(connection);
+			}
+		}
+
+		static void OnAccept(IAsyncResult* result)
+		{
+			Server* server = reinterpret_cast<Server*>(result->AsyncState());
+			Socket accepted[AcceptBatch];
+			int count = 0;
+			try {
+				count = server->listener.EndAccept(result, accepted);
+			} catch( SocketException& ) {
+				server->StopAccepting();
+				return;
+			}
+
+			for( int i = 0; i < count; i++ ) {
+				if( server->role == Role::Hangup )
+					accepted[i].Close();
+				else
+					server->BeginReceive(server->Open(accepted[i]));
+			}
+			if( server->Running() == true )
+				server->BeginAccept();
+			else
+				server->StopAccepting();
+		}
+
+		static void OnReceive(IAsyncResult* result)
+		{
+			Connection* connection = reinterpret_cast<Connection*>(result->AsyncState());
+			Server* server = connection->server;
+			int length = 0;
+			try {
+				length = connection->socket.EndReceive(result);
+			} catch( SocketException& ) {
+			}
+			if( length == 0 ) {
+				server->Close(connection);
+				return;
+			}
+
+			if( server->role != Role::Echo ) {
+				server->BeginReceive(connection);
+				return;
+			}
+			try {
+				connection->socket.BeginSend(connection->buffer, 0, length, &OnSent, connection, *connection->manager);
+			} catch( SocketException& ) {
+				server->Close(connection);
+			}
+		}
+
+		static void OnSent(IAsyncResult* result)
+		{
+			Connection* connection = reinterpret_cast<Connection*>(result->AsyncState());
+			try {
+				connection->socket.EndSend(result);
+			} catch( SocketException& ) {
+				connection->server->Close(connection);
+				return;
+			}
+			connection->server->BeginReceive(connection);
+		}
+
+		void Start()
+		{
+			listener = Socket(AdressFamilly::InterNetwork, SocketType::Stream, ProtocolType::Tcp);
+			try {
+				//the hangup scenario leaves the port in TIME_WAIT
+				listener.Disconnect(true);
+				listener.Bind(endPoint);
+				listener.Listen(Backlog);
+			} catch( SocketException& ) {
+				listener.Close();
+				throw;
+			}
+			running = true;
+
+			switch( mode ) {
+				case BenchmarkMode::Blocking:
+					if( thread.Start(&AcceptBlocking, this) == false ) {
+						throw SocketException("Unable to start the acceptor thread.");
+					}
+					break;
+				case BenchmarkMode::Poll:
+					if( thread.Start(&PollLoop, this) == false ) {
+						throw SocketException("Unable to start the polling thread.");
+					}
+					break;
+				default:
+					#if PLATFORM == PLATFORM_LINUX
+					if( mode == BenchmarkMode::Epoll ) {
+						manager = new EpollIOManager();
+					} else if( mode == BenchmarkMode::Uring ) {
+						manager = new UringIOManager();
+					} else {
+						//the listener stays on the first loop, accepted connections are assigned round-robin
+						runtime = loops > 0 ? new Runtime(loops, 1) : new Runtime();
+						manager = &runtime->Loop(0);
+					}
+					accepting = true;
+					BeginAccept();
+					#else
+					throw SocketException("The mode is not supported on this platform.");
+					#endif
+					break;
+			}
+		}
+
+		void Stop()
+		{
+			{
+				ScopedLock lock(mutex);
+				running = false;
+			}
+
+			if( mode == BenchmarkMode::Blocking ) {
+				//wakes the acceptor, which then sees that the server stopped
+				Socket wake(AdressFamilly::InterNetwork, SocketType::Stream, ProtocolType::Tcp);
+				SocketError::Enum error;
+				wake.Connect(endPoint, error);
+				thread.Join();
+				wake.Close();
+			} else if( mode == BenchmarkMode::Poll ) {
+				thread.Join();
+			}
+			listener.Close();
+
+			//connections the clients left open are shut down so their handlers end
+			ScopedLock lock(mutex);
+			while( accepting == true )
+				condition.Wait(mutex);
+			for( std::set<Connection*>::iterator i = connections.begin(); i != connections.end(); ++i )
+				(*i)->socket.Shutdown(2);
+			while( connections.empty() == false )
+				condition.Wait(mutex);
+			for( size_t i = 0; i < finished.size(); i++ ) {
+				finished[i]->thread.Join();
+				delete finished[i];
+			}
+			finished.clear();
+		}
+
+		~Server()
+		{
+			#if PLATFORM == PLATFORM_LINUX
+			if( runtime != 0x0 ) {
+				delete runtime;
+				return;
+			}
+			#endif
+			delete manager;
+		}
+	};
+
+	struct Client
+	{
+		IPEndPoint		endPoint;
+		const Benchmark::Options* options;
+		Thread			thread;
+		//connections the client exchanges messages over
+		std::vector<Socket> sockets;
+		uint64			deadline;
+		uint64			operations;
+		uint64			bytes;
+		Histogram		latency;
+		std::string		error;
+
+		Client(const Benchmark::Options& o)
+			: endPoint(IPAdress::Loopback, o.port), options(&o), deadline(0), operations(0), bytes(0)
+		{
+		}
+
+		static void Stream(void* argument)
+		{
+			Client* client = reinterpret_cast<Client*>(argument);
+			std::vector<uint8> buffer(client->options->chunkSize);
+			try {
+				Socket socket = Connect(client->endPoint);
+				while( Nanoseconds() < client->deadline ) {
+					client->bytes += socket.Send(&buffer[0], 0, (int32)buffer.size());
+					client->operations++;
+				}
+				socket.Close();
+			} catch( SocketException& exception ) {
+				client->error = exception.what();
+			}
+		}
+
+		static void Exchange(void* argument)
+		{
+			Client* client = reinterpret_cast<Client*>(argument);
+			std::vector<uint8> buffer(client->options->messageSize);
+			if( client->sockets.empty() == true )
+				return;
+			try {
+				for( size_t next = 0; Nanoseconds() < client->deadline; next = (next + 1) % client->sockets.size() ) {
+					uint64 start = Nanoseconds();
+					SendAll(client->sockets[next], &buffer[0], (int32)buffer.size());
+					ReceiveAll(client->sockets[next], &buffer[0], (int32)buffer.size());
+					client->latency.Record(Nanoseconds() - start);
+					client->operations++;
+					client->bytes += 2 * buffer.size();
+				}
+			} catch( SocketException& exception ) {
+				client->error = exception.what();
+			}
+		}
+
+		static void Reconnect(void* argument)
+		{
+			Client* client = reinterpret_cast<Client*>(argument);
+			try {
+				while( Nanoseconds() < client->deadline ) {
+					//the connection counts once the server accepted and closed it
+					uint64 start = Nanoseconds();
+					Socket socket = Connect(client->endPoint);
+					uint8 end;
+					int length = socket.Receive(&end, 0, 1);
+					socket.Close();
+					if( length != 0 ) {
+						throw SocketException("The server did not close the connection.");
+					}
+					client->latency.Record(Nanoseconds() - start);
+					client->operations++;
+				}
+			} catch( SocketException& exception ) {
+				client->error = exception.what();
+			}
+		}
+	};
+
+	//runs the clients for the duration of the scenario and sums them up in the report
+	void Run(std::vector<Client*>& clients, Thread::Function function, const Benchmark::Options& options, Benchmark::Report& report)
+	{
+		uint64 start = Nanoseconds();
+		for( size_t i = 0; i < clients.size(); i++ ) {
+			clients[i]->deadline = start + (uint64)options.duration * 1000000;
+			if( clients[i]->thread.Start(function, clients[i]) == false )
+				clients[i]->error = "Unable to start the client thread.";
+		}
+		std::string error;
+		for( size_t i = 0; i < clients.size(); i++ ) {
+			clients[i]->thread.Join();
+			report.operations += clients[i]->operations;
+			report.bytes += clients[i]->bytes;
+			report.latency.Add(clients[i]->latency);
+			if( error.empty() == true )
+				error = clients[i]->error;
+		}
+		report.elapsed = Nanoseconds() - start;
+		if( error.empty() == false ) {
+			throw SocketException(error.c_str());
+		}
+	}
+
+	void Release(std::vector<Client*>& clients)
+	{
+		//the sockets of a client close with it
+		for( size_t i = 0; i < clients.size(); i++ )
+			delete clients[i];
+		clients.clear();
+	}
+
+	//the server and the clients of a scenario, released on every way out
+	struct Scenario
+	{
+		Server server;
+		std::vector<Client*> clients;
+
+		Scenario(const Benchmark::Options& options, Role::Enum role)
+			: server(options.mode, role, options.port, options.loops)
+		{
+			if( Benchmark::Available(options.mode) == false ) {
+				throw SocketException("The mode is not supported on this platform.");
+			}
+			if( options.clients < 1 ) {
+				throw SocketException("Argument clients is out of range.");
+			}
+			if( options.loops < 0 ) {
+				throw SocketException("Argument loops is out of range.");
+			}
+			server.Start();
+			for( int i = 0; i < options.clients; i++ )
+				clients.push_back(new Client(options));
+		}
+
+		~Scenario()
+		{
+			Release(clients);
+			server.Stop();
+		}
+	};
+
+	std::string NameOf(const char* scenario, BenchmarkMode::Enum mode)
+	{
+		return std::string(scenario) + "/" + Benchmark::Name(mode);
+	}
+
+	//both ends of every connection live in this process
+	void ReserveDescriptors(int connections)
+	{
+		#if PLATFORM == PLATFORM_LINUX
+		rlimit limit;
+		if( getrlimit(RLIMIT_NOFILE, &limit) != 0 )
+			return;
+		rlim_t needed = (rlim_t)connections * 2 + 64;
+		if( limit.rlim_cur < needed ) {
+			limit.rlim_cur = limit.rlim_max < needed ? limit.rlim_max : needed;
+			setrlimit(RLIMIT_NOFILE, &limit);
+			if( limit.rlim_cur < needed ) {
+				throw SocketException("The descriptor limit is too low for the number of connections.");
+			}
+		}
+		#endif
+	}
+}
+
+Benchmark::Options::Options()
+	: mode(BenchmarkMode::Blocking), port(3200), duration(2000), clients(1),
+	  chunkSize(64 * 1024), messageSize(64), connections(10000), active(100), loops(0)
+{
+}
+
+Benchmark::Report::Report() : operations(0), bytes(0), elapsed(0)
+{
+}
+
+void Benchmark::Report::Print()
+{
+	double seconds = elapsed / 1e9;
+	printf("%-22s %10llu ops %11.0f ops/s", name.c_str(), (unsigned long long)operations, seconds > 0 ? operations / seconds : 0.0);
+	if( bytes > 0 )
+		printf(" %9.1f MB/s", seconds > 0 ? bytes / seconds / (1024 * 1024) : 0.0);
+	if( latency.Count() > 0 ) {
+		printf("  latency us p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f",
+			latency.Percentile(50) / 1e3, latency.Percentile(90) / 1e3, latency.Percentile(99) / 1e3,
+			latency.Percentile(99.9) / 1e3, latency.Max() / 1e3);
+	}
+	printf("\r\n");
+}
+
+const char* Benchmark::Name(BenchmarkMode::Enum mode)
+{
+	switch( mode ) {
+		case BenchmarkMode::Blocking:	return "blocking";
+		case BenchmarkMode::Poll:		return "poll";
+		case BenchmarkMode::Epoll:		return "epoll";
+		case BenchmarkMode::Uring:		return "uring";
+		case BenchmarkMode::Runtime:	return "runtime";
+	}
+	return "unknown";
+}
+
+bool Benchmark::Available(BenchmarkMode::Enum mode)
+{
+	#if PLATFORM == PLATFORM_LINUX
+	return true;
+	#else
+	return mode == BenchmarkMode::Blocking || mode == BenchmarkMode::Poll;
+	#endif
+}
+
+void Benchmark::Throughput(const Options& options, Report& report)
+{
+	report.name = NameOf("throughput", options.mode);
+	Scenario scenario(options, Role::Sink);
+	Run(scenario.clients, &Client::Stream, options, report);
+}
+
+void Benchmark::PingPong(const Options& options, Report& report)
+{
+	report.name = NameOf("pingpong", options.mode);
+	Scenario scenario(options, Role::Echo);
+	for( size_t i = 0; i < scenario.clients.size(); i++ )
+		scenario.clients[i]->sockets.push_back(Connect(scenario.server.endPoint));
+	Run(scenario.clients, &Client::Exchange, options, report);
+}
+
+void Benchmark::ConnectRate(const Options& options, Report& report)
+{
+	report.name = NameOf("connect", options.mode);
+	Scenario scenario(options, Role::Hangup);
+	Run(scenario.clients, &Client::Reconnect, options, report);
+}
+
+void Benchmark::Scale(const Options& options, Report& setup, Report& active)
+{
+	setup.name = NameOf("scale-setup", options.mode);
+	active.name = NameOf("scale-active", options.mode);
+	if( options.active < 1 || options.active > options.connections ) {
+		throw SocketException("Argument active is out of range.");
+	}
+	ReserveDescriptors(options.connections);
+
+	Scenario scenario(options, Role::Echo);
+	//idle connections are kept here, the active ones by the clients, all are closed on the way out
+	std::vector<Socket> idle;
+	uint64 start = Nanoseconds();
+	int stride = options.connections / options.active;
+	for( int i = 0; i < options.connections; i++ ) {
+		std::vector<Socket>& sockets = i % stride == 0 && i / stride < options.active
+			? scenario.clients[(i / stride) % scenario.clients.size()]->sockets : idle;
+		sockets.push_back(Socket(AdressFamilly::InterNetwork, SocketType::Stream, ProtocolType::Tcp));
+		Socket& socket = sockets.back();
+
+		//every further loopback source address has its own ephemeral ports, the first one is
+		//left to connect because an explicit bind searches the ports linearly
+		if( i >= ConnectionsPerSource ) {
+			IPAdress source((uint32)(IPAdress::Loopback.adress + ((uint64)(i / ConnectionsPerSource) << 24)));
+			socket.Bind(IPEndPoint(source, 0));
+		}
+		uint64 connecting = Nanoseconds();
+		socket.Connect(scenario.server.endPoint);
+		setup.latency.Record(Nanoseconds() - connecting);
+		setup.operations++;
+	}
+	setup.elapsed = Nanoseconds() - start;
+
+	Run(scenario.clients, &Client::Exchange, options, active);
+}
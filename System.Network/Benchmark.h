@@ -0,0 +1,74 @@
+#pragma once
+#include "Network.h"
+#include "Histogram.h"
+#include <string>
+
+namespace BenchmarkMode
+{
+	enum Enum
+	{
+		//a thread per connection on blocking sockets
+		Blocking,
+		//a single thread waiting on a SocketPoller
+		Poll,
+		//SocketIOManager backends, linux only
+		Epoll,
+		Uring,
+		//a Runtime that spreads the connections over its pinned loops, linux only
+		Runtime
+	};
+}
+
+/*
+	Loopback benchmarks. The server side of every scenario runs in the
+	chosen mode while the clients always use blocking sockets on their own
+	threads, so runs of different modes put the same load on the server
+	implementations. Throughput streams into a sink, PingPong and Scale
+	measure round trips against an echo server and ConnectRate connects to
+	a server that hangs up right after the accept. Latencies are recorded
+	in nanoseconds.
+*/
+struct Benchmark
+{
+	struct Options
+	{
+		BenchmarkMode::Enum mode;
+		int		port;
+		//milliseconds each timed scenario runs
+		int		duration;
+		//client threads, each with its own connection
+		int		clients;
+		//bytes per send of Throughput and per message of PingPong and Scale
+		int32	chunkSize;
+		int32	messageSize;
+		//connections Scale keeps open and how many of them exchange messages
+		int		connections;
+		int		active;
+		//loops of the Runtime mode, 0 for one per core
+		int		loops;
+		Options();
+	};
+
+	struct Report
+	{
+		std::string	name;
+		uint64		operations;
+		uint64		bytes;
+		//nanoseconds
+		uint64		elapsed;
+		Histogram	latency;
+		Report();
+		void Print();
+	};
+
+	static const char* Name(BenchmarkMode::Enum mode);
+	//whether the mode is supported on this platform
+	static bool Available(BenchmarkMode::Enum mode);
+
+	static void Throughput(const Options& options, Report& report);
+	static void PingPong(const Options& options, Report& report);
+	static void ConnectRate(const Options& options, Report& report);
+	//opens options.connections connections, idle ones included, setup reports the connects
+	//and active the round trips over options.active of them
+	static void Scale(const Options& options, Report& setup, Report& active);
+};
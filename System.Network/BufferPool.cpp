@@ -0,0 +1,295 @@
+#include "BufferPool.h"
+#include "Threading.h"
+#include <stdlib.h>
+#include <vector>
+
+#if PLATFORM == PLATFORM_WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+	//pools a thread caches buffers for, and the buffers cached per pool
+	const int CacheSlots = 4;
+	const int CacheDepth = 64;
+	const size_t HugePageSize = 2 * 1024 * 1024;
+
+	struct Node
+	{
+		Node* next;
+	};
+
+	struct Cache
+	{
+		uint64	pool;
+		Node*	head;
+		int		count;
+		//when the thread last used the slot, the least recent one is evicted
+		uint64	used;
+	};
+
+	THREAD_LOCAL Cache caches[CacheSlots];
+	THREAD_LOCAL uint64 tick = 0;
+	//whether the caches of the thread are handed back when it exits
+	THREAD_LOCAL bool attached = false;
+
+	struct Slab
+	{
+		void*	base;
+		size_t	bytes;
+		bool	mapped;
+	};
+
+	//live pools by id, caches of destroyed pools are dropped without being touched
+	Mutex registryMutex;
+	std::vector<BufferPool::Impl*> registry;
+	uint64 nextId = 1;
+}
+
+struct BufferPool::Impl
+{
+	uint64	id;
+	size_t	size;
+	int32	slabBuffers;
+	bool	hugePages;
+	Mutex	mutex;
+	Node*	free;
+	std::vector<Slab> slabs;
+
+	//moves up to count nodes from the shared free list onto head, pool lock must be held
+	int Take(Node*& head, int count)
+	{
+		if( free == 0x0 )
+			Grow();
+
+		int taken = 0;
+		while( free != 0x0 && taken < count ) {
+			Node* node = free;
+			free = node->next;
+			node->next = head;
+			head = node;
+			taken++;
+		}
+		return taken;
+	}
+
+	//returns count nodes from head to the shared free list, pool lock must be held
+	void Give(Node*& head, int count)
+	{
+		while( head != 0x0 && count-- > 0 ) {
+			Node* node = head;
+			head = node->next;
+			node->next = free;
+			free = node;
+		}
+	}
+
+	void Grow()
+	{
+		Slab slab;
+		slab.bytes = size * slabBuffers;
+		slab.mapped = false;
+		slab.base = 0x0;
+		if( hugePages == true ) {
+			slab.bytes = (slab.bytes + HugePageSize - 1) & ~(HugePageSize - 1);
+			#if PLATFORM == PLATFORM_WIN32
+			slab.base = VirtualAlloc(0x0, slab.bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+			if( slab.base == 0x0 )
+				slab.base = VirtualAlloc(0x0, slab.bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+			#else
+			slab.base = mmap(0x0, slab.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+			if( slab.base == MAP_FAILED )
+				slab.base = mmap(0x0, slab.bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if( slab.base == MAP_FAILED )
+				slab.base = 0x0;
+			#endif
+			slab.mapped = true;
+		} else {
+			slab.base = malloc(slab.bytes);
+		}
+
+		if( slab.base == 0x0 ) {
+			throw SocketException("Unable to allocate the buffer pool slab.");
+		}
+		slabs.push_back(slab);
+
+		uint8* base = reinterpret_cast<uint8*>(slab.base);
+		for( size_t i = slab.bytes / size; i > 0; i-- ) {
+			Node* node = reinterpret_cast<Node*>(base + (i - 1) * size);
+			node->next = free;
+			free = node;
+		}
+	}
+};
+
+namespace
+{
+	//hands the cached buffers back to their pool, unless it was destroyed meanwhile
+	void Flush(Cache& cache)
+	{
+		if( cache.head != 0x0 ) {
+			ScopedLock lock(registryMutex);
+			for( size_t i = 0; i < registry.size(); i++ ) {
+				if( registry[i]->id == cache.pool ) {
+					ScopedLock poolLock(registry[i]->mutex);
+					registry[i]->Give(cache.head, cache.count);
+					break;
+				}
+			}
+		}
+		cache.pool = 0;
+		cache.head = 0x0;
+		cache.count = 0;
+	}
+
+	//runs as the thread exits, its caches would be lost otherwise
+	#if PLATFORM == PLATFORM_WIN32
+	void WINAPI Drain(void* slots)
+	#else
+	void Drain(void* slots)
+	#endif
+	{
+		if( slots == 0x0 )
+			return;
+		for( int i = 0; i < CacheSlots; i++ )
+			Flush(reinterpret_cast<Cache*>(slots)[i]);
+		//a later destructor that releases buffers attaches the thread again
+		attached = false;
+	}
+
+	struct ExitKey
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		DWORD	key;
+		ExitKey() { key = FlsAlloc(&Drain); }
+		#else
+		pthread_key_t key;
+		ExitKey() { pthread_key_create(&key, &Drain); }
+		#endif
+	};
+
+	ExitKey exitKey;
+
+	//finds the cache of the pool, claiming a free slot when the thread has none for it yet and
+	//evicting the least recently used one only when every slot is taken
+	Cache& Local(BufferPool::Impl* pool)
+	{
+		Cache* victim = &caches[0];
+		for( int i = 0; i < CacheSlots; i++ ) {
+			if( caches[i].pool == pool->id ) {
+				caches[i].used = ++tick;
+				return caches[i];
+			}
+			if( victim->pool != 0 && (caches[i].pool == 0 || caches[i].used < victim->used) )
+				victim = &caches[i];
+		}
+
+		if( attached == false ) {
+			attached = true;
+			#if PLATFORM == PLATFORM_WIN32
+			FlsSetValue(exitKey.key, caches);
+			#else
+			pthread_setspecific(exitKey.key, caches);
+			#endif
+		}
+		Flush(*victim);
+		victim->pool = pool->id;
+		victim->used = ++tick;
+		return *victim;
+	}
+}
+
+BufferPool::BufferPool(int32 bufferSize)
+{
+	Init(bufferSize, 256, false);
+}
+
+BufferPool::BufferPool(int32 bufferSize, int32 slabBuffers, bool hugePages)
+{
+	Init(bufferSize, slabBuffers, hugePages);
+}
+
+void BufferPool::Init(int32 bufferSize, int32 slabBuffers, bool hugePages)
+{
+	if( bufferSize < 1 || slabBuffers < 1 ) {
+		throw SocketException("Argument bufferSize or slabBuffers is out of range.");
+	}
+
+	m_impl = new Impl();
+	//keeps every buffer aligned for the free list and for vectorised copies
+	m_impl->size = (bufferSize + 15) & ~(size_t)15;
+	m_impl->slabBuffers = slabBuffers;
+	m_impl->hugePages = hugePages;
+	m_impl->free = 0x0;
+
+	ScopedLock lock(registryMutex);
+	m_impl->id = nextId++;
+	registry.push_back(m_impl);
+}
+
+BufferPool::~BufferPool()
+{
+	{
+		ScopedLock lock(registryMutex);
+		for( size_t i = 0; i < registry.size(); i++ ) {
+			if( registry[i] == m_impl ) {
+				registry.erase(registry.begin() + i);
+				break;
+			}
+		}
+	}
+
+	//the calling thread's cache is the only one that can be reset safely
+	for( int i = 0; i < CacheSlots; i++ ) {
+		if( caches[i].pool == m_impl->id ) {
+			caches[i].pool = 0;
+			caches[i].head = 0x0;
+			caches[i].count = 0;
+		}
+	}
+
+	for( size_t i = 0; i < m_impl->slabs.size(); i++ ) {
+		Slab& slab = m_impl->slabs[i];
+		#if PLATFORM == PLATFORM_WIN32
+		if( slab.mapped == true ) VirtualFree(slab.base, 0, MEM_RELEASE);
+		#else
+		if( slab.mapped == true ) munmap(slab.base, slab.bytes);
+		#endif
+		else free(slab.base);
+	}
+	delete m_impl;
+}
+
+int32 BufferPool::BufferSize()
+{
+	return (int32)m_impl->size;
+}
+
+uint8* BufferPool::Acquire()
+{
+	Cache& cache = Local(m_impl);
+	if( cache.head == 0x0 ) {
+		ScopedLock lock(m_impl->mutex);
+		cache.count += m_impl->Take(cache.head, CacheDepth / 2);
+	}
+
+	Node* node = cache.head;
+	cache.head = node->next;
+	cache.count--;
+	return reinterpret_cast<uint8*>(node);
+}
+
+void BufferPool::Release(uint8* buffer)
+{
+	Cache& cache = Local(m_impl);
+	Node* node = reinterpret_cast<Node*>(buffer);
+	node->next = cache.head;
+	cache.head = node;
+	if( ++cache.count > CacheDepth ) {
+		ScopedLock lock(m_impl->mutex);
+		m_impl->Give(cache.head, CacheDepth / 2);
+		cache.count -= CacheDepth / 2;
+	}
+}
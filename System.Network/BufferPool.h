@@ -0,0 +1,60 @@
+#pragma once
+#include "Network.h"
+#include <cstddef>
+
+/*
+	Pool of fixed-size I/O buffers. Buffers are carved out of slabs that
+	are only returned to the system when the pool is destroyed, so a long
+	running process does not fragment its heap. Every thread keeps a small
+	cache of free buffers per pool, acquiring and releasing only takes the
+	pool lock to exchange half a cache with the shared free list. Slabs can
+	be backed by huge pages, falling back to regular pages when the system
+	has none reserved.
+*/
+struct BufferPool
+{
+	struct Impl;
+	Impl* m_impl;
+
+	BufferPool(int32 bufferSize);
+	BufferPool(int32 bufferSize, int32 slabBuffers, bool hugePages);
+	~BufferPool();
+
+	int32  BufferSize();
+	uint8* Acquire();
+	//the buffer may be released from any thread
+	void   Release(uint8* buffer);
+
+private:
+	void Init(int32 bufferSize, int32 slabBuffers, bool hugePages);
+	BufferPool(const BufferPool&);
+	BufferPool& operator=(const BufferPool&);
+};
+
+//routes operator new/delete of T through a pool of sizeof(T) blocks,
+//classes deriving from a pooled class bring in their own with using declarations
+template<class T> struct Pooled
+{
+	static BufferPool& Pool()
+	{
+		//never destroyed, objects may still be released while statics are torn down
+		static BufferPool* pool = new BufferPool(sizeof(T), 64, false);
+		return *pool;
+	}
+
+	//derived classes that did not bring in their own pool fall back to the heap
+	static void* operator new(size_t size)
+	{
+		if( size != sizeof(T) )
+			return ::operator new(size);
+		return Pool().Acquire();
+	}
+
+	static void operator delete(void* pointer, size_t size)
+	{
+		if( size != sizeof(T) )
+			::operator delete(pointer);
+		else
+			Pool().Release(reinterpret_cast<uint8*>(pointer));
+	}
+};
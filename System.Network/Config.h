@@ -11,6 +11,9 @@
 #  define PLATFORM__ PLATFORM_UNIX
 #endif
 
+#define PLATFORM_LINUX PLATFORM_UNIX
+#define PLATFORM PLATFORM__
+
 #ifdef _MSC_VER // MS VC++
 
 	typedef __int64				int64;
@@ -85,4 +88,24 @@ template<int S> struct aligned8
 	}
 };
 
+#ifdef _MSC_VER
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+//C++20 coroutine support, enables the co_await-able Async socket methods
+#if defined( __cpp_impl_coroutine ) && __cpp_impl_coroutine >= 201902L
+#define HAS_COROUTINES 1
+#else
+#define HAS_COROUTINES 0
+#endif
+
+//C++11 rvalue references, Socket is move-only with them
+#if __cplusplus >= 201103L || (defined( _MSC_VER ) && _MSC_VER >= 1900)
+#define HAS_MOVE_SEMANTICS 1
+#else
+#define HAS_MOVE_SEMANTICS 0
+#endif
+
 #define STATIC_ASSERT(expr)	typedef char CC_##__LINE__ [(expr) ? 1 : -1]
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "ConnectionPool.h"
+#include "Threading.h"
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace
+{
+	struct Idle
+	{
+		Socket	socket;
+		uint64	since;
+	};
+
+	struct Connections
+	{
+		//oldest first, connections are handed out from the back
+		std::deque<Idle> idle;
+		//handed out and not yet released
+		int32 active;
+		Connections() : active(0) { }
+	};
+
+	typedef std::pair<uint64, int32> Key;
+
+	Key ToKey(const IPEndPoint& endPoint)
+	{
+		return Key(endPoint.adress.adress, endPoint.port);
+	}
+
+	//an idle connection is healthy when it has neither data, end of stream nor an error pending,
+	//all of which make it readable
+	bool Healthy(Socket& socket)
+	{
+		try {
+			return socket.Poll(0, SelectMode::SelectRead) == false;
+		} catch( SocketException& ) {
+			return false;
+		}
+	}
+}
+
+struct ConnectionPool::Impl
+{
+	Mutex	mutex;
+	int32	maxIdle;
+	int32	maxPerEndPoint;
+	int		idleTimeout;
+	std::map<Key, Connections> endPoints;
+
+	//moves the connections idle past the timeout to expired, lock must be held
+	void Expire(Connections& connections, uint64 now, std::vector<Socket>& expired)
+	{
+		while( connections.idle.empty() == false && connections.idle.front().since + idleTimeout <= now ) {
+			expired.push_back(SOCKET_MOVE(connections.idle.front().socket));
+			connections.idle.pop_front();
+		}
+	}
+};
+
+namespace
+{
+	void Close(std::vector<Socket>& sockets)
+	{
+		for( size_t i = 0; i < sockets.size(); i++ )
+			sockets[i].Close();
+		sockets.clear();
+	}
+}
+
+ConnectionPool::ConnectionPool( int32 maxIdle, int32 maxPerEndPoint, int idleTimeout )
+{
+	if( maxIdle < 0 || maxPerEndPoint < 1 || maxIdle > maxPerEndPoint ) {
+		throw SocketException("Argument maxIdle or maxPerEndPoint is out of range.");
+	}
+	if( idleTimeout < 0 ) {
+		throw SocketException("Argument idleTimeout is out of range.");
+	}
+
+	m_impl = new Impl();
+	m_impl->maxIdle = maxIdle;
+	m_impl->maxPerEndPoint = maxPerEndPoint;
+	m_impl->idleTimeout = idleTimeout;
+}
+
+ConnectionPool::~ConnectionPool()
+{
+	std::vector<Socket> idle;
+	for( std::map<Key, Connections>::iterator it = m_impl->endPoints.begin(); it != m_impl->endPoints.end(); ++it ) {
+		for( size_t i = 0; i < it->second.idle.size(); i++ )
+			idle.push_back(SOCKET_MOVE(it->second.idle[i].socket));
+	}
+	Close(idle);
+	delete m_impl;
+}
+
+Socket ConnectionPool::Acquire( const IPEndPoint& endPoint )
+{
+	return Acquire(endPoint, -1);
+}
+
+Socket ConnectionPool::Acquire( const IPEndPoint& endPoint, int timeout )
+{
+	std::vector<Socket> closing;
+	for( ;; ) {
+		Socket socket;
+		bool found = false, exhausted = false;
+		{
+			ScopedLock lock(m_impl->mutex);
+			Connections& connections = m_impl->endPoints[ToKey(endPoint)];
+			m_impl->Expire(connections, Milliseconds(), closing);
+			if( connections.idle.empty() == false ) {
+				socket = SOCKET_MOVE(connections.idle.back().socket);
+				connections.idle.pop_back();
+				found = true;
+			} else if( connections.active >= m_impl->maxPerEndPoint ) {
+				exhausted = true;
+			}
+			//the slot is taken before connecting so concurrent callers respect the limit
+			if( exhausted == false )
+				connections.active++;
+		}
+		Close(closing);
+
+		if( exhausted == true ) {
+			throw SocketException("Every connection to the endpoint is in use.");
+		}
+		if( found == false )
+			break;
+		if( Healthy(socket) == true )
+			return socket;
+
+		//the peer closed or wrote to the idle connection, try the next one
+		socket.Close();
+		ScopedLock lock(m_impl->mutex);
+		m_impl->endPoints[ToKey(endPoint)].active--;
+	}
+
+	try {
+		//Connect creates the descriptor of the winning attempt itself
+		Socket socket;
+		socket.Connect(&endPoint, 1, timeout);
+		return socket;
+	} catch( SocketException& ) {
+		ScopedLock lock(m_impl->mutex);
+		m_impl->endPoints[ToKey(endPoint)].active--;
+		throw;
+	}
+}
+
+void ConnectionPool::Release( const IPEndPoint& endPoint, Socket& socket, bool reusable )
+{
+	std::vector<Socket> closing;
+	{
+		ScopedLock lock(m_impl->mutex);
+		Connections& connections = m_impl->endPoints[ToKey(endPoint)];
+		connections.active--;
+
+		uint64 now = Milliseconds();
+		m_impl->Expire(connections, now, closing);
+		if( reusable == true && (int32)connections.idle.size() < m_impl->maxIdle ) {
+			Idle idle;
+			idle.socket = SOCKET_MOVE(socket);
+			idle.since = now;
+			connections.idle.push_back(SOCKET_MOVE(idle));
+		} else {
+			closing.push_back(SOCKET_MOVE(socket));
+		}
+	}
+	Close(closing);
+}
+
+int ConnectionPool::Evict()
+{
+	std::vector<Socket> closing;
+	{
+		ScopedLock lock(m_impl->mutex);
+		uint64 now = Milliseconds();
+		for( std::map<Key, Connections>::iterator it = m_impl->endPoints.begin(); it != m_impl->endPoints.end(); ) {
+			m_impl->Expire(it->second, now, closing);
+			if( it->second.idle.empty() == true && it->second.active == 0 )
+				m_impl->endPoints.erase(it++);
+			else
+				++it;
+		}
+	}
+
+	int count = (int)closing.size();
+	Close(closing);
+	return count;
+}
+
+int32 ConnectionPool::IdleCount( const IPEndPoint& endPoint )
+{
+	ScopedLock lock(m_impl->mutex);
+	std::map<Key, Connections>::iterator it = m_impl->endPoints.find(ToKey(endPoint));
+	return it != m_impl->endPoints.end() ? (int32)it->second.idle.size() : 0;
+}
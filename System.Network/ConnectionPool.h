@@ -0,0 +1,35 @@
+#pragma once
+#include "Network.h"
+
+/*
+	Keeps connected sockets per endpoint for reuse. Acquire hands out the
+	most recently released idle connection that is still healthy, a cheap
+	non-blocking Poll that finds no pending data or end of stream, and
+	connects a new socket otherwise. Idle connections past the idle timeout
+	are closed whenever their endpoint is used and by Evict, which callers
+	with many quiet endpoints run periodically.
+*/
+struct ConnectionPool
+{
+	struct Impl;
+	Impl* m_impl;
+
+	//maxIdle sockets are kept per endpoint, at most maxPerEndPoint are open per endpoint including the idle ones
+	ConnectionPool( int32 maxIdle, int32 maxPerEndPoint, int idleTimeout );
+	//closes the idle connections, sockets still handed out stay open
+	~ConnectionPool();
+
+	//throws when maxPerEndPoint connections to the endpoint are in use, timeout bounds a new connect
+	Socket Acquire( const IPEndPoint& endPoint );
+	Socket Acquire( const IPEndPoint& endPoint, int timeout );
+	//takes the connection back, leaving socket without a descriptor; sockets that are not reusable
+	//are closed and free their slot
+	void Release( const IPEndPoint& endPoint, Socket& socket, bool reusable );
+	//closes the connections idle for longer than the idle timeout, returns how many were closed
+	int  Evict();
+	int32 IdleCount( const IPEndPoint& endPoint );
+
+private:
+	ConnectionPool(const ConnectionPool&);
+	ConnectionPool& operator=(const ConnectionPool&);
+};
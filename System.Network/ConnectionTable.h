@@ -0,0 +1,173 @@
+#pragma once
+#include "Network.h"
+#include <vector>
+
+#if defined( _WIN64 ) || defined( __LP64__ )
+#define HAS_HANDLE_STATE 1
+#else
+#define HAS_HANDLE_STATE 0
+#endif
+
+//names a connection of a ConnectionTable, the generation tells it apart from
+//connections that had the same descriptor before or after it
+struct ConnectionHandle
+{
+	uint32	index;
+	//0 is never handed out
+	uint32	generation;
+
+	ConnectionHandle() : index(0), generation(0) { }
+	ConnectionHandle( uint32 i, uint32 g ) : index(i), generation(g) { }
+
+	#if HAS_HANDLE_STATE
+	//carries the handle as the state of an asynchronous operation, so a completion
+	//finds its connection without a lookup structure of its own
+	void* ToState() const
+	{
+		return reinterpret_cast<void*>(((uint64)(generation & 0xffffffff) << 32) | (index & 0xffffffff));
+	}
+
+	static ConnectionHandle FromState( void* state )
+	{
+		uint64 value = (uint64)reinterpret_cast<size_t>(state);
+		return ConnectionHandle((uint32)(value & 0xffffffff), (uint32)(value >> 32));
+	}
+	#endif
+};
+
+/*
+	Per connection state kept in one array indexed by descriptor. A slot
+	holds the Socket and a T next to the generation of the connection, so
+	Find is an index and a compare. Remove closes the socket and bumps the
+	generation, handles of the removed connection find nothing from then on
+	even once the kernel hands the descriptor out again. The array grows to
+	the highest descriptor added, which moves every slot: reserve capacity
+	up front, pointers returned by Find stay valid until the table grows.
+	The table does no locking.
+*/
+template<class T> struct ConnectionTable
+{
+	//slots for descriptors below capacity are allocated up front
+	explicit ConnectionTable( int32 capacity = 0 ) : count(0)
+	{
+		if( capacity < 0 ) {
+			throw SocketException("Argument capacity is out of range.");
+		}
+		slots.resize(capacity);
+	}
+
+	//takes the socket over, throws when it holds no descriptor or one that is already in the table
+	ConnectionHandle Add( Socket& socket, const T& value )
+	{
+		if( socket.Valid() == false ) {
+			throw SocketException("The socket is not valid.");
+		}
+		uint32 index = IndexOf(socket.Descriptor());
+		if( index >= slots.size() )
+			slots.resize(index + 1 > slots.size() * 2 ? index + 1 : slots.size() * 2);
+
+		Slot& slot = slots[index];
+		if( slot.used == true ) {
+			//the socket of the slot was closed without removing it, the descriptor was reused since
+			if( slot.socket.Valid() == true ) {
+				throw SocketException("The descriptor is already in the table.");
+			}
+			Retire(slot);
+		}
+		slot.used = true;
+		slot.socket = SOCKET_MOVE(socket);
+		slot.value = value;
+		count++;
+		return ConnectionHandle(index, slot.generation);
+	}
+
+	//0x0 when the connection was removed
+	T* Find( ConnectionHandle handle )
+	{
+		Slot* slot = Get(handle);
+		return slot != 0x0 ? &slot->value : 0x0;
+	}
+
+	Socket* FindSocket( ConnectionHandle handle )
+	{
+		Slot* slot = Get(handle);
+		return slot != 0x0 ? &slot->socket : 0x0;
+	}
+
+	#if HAS_HANDLE_STATE
+	//the connection whose handle was passed as the state of the operation
+	T* Find( IAsyncResult* result )
+	{
+		return Find(ConnectionHandle::FromState(result->AsyncState()));
+	}
+	#endif
+
+	//the handle of the connection holding the descriptor of socket, a handle that finds nothing otherwise
+	ConnectionHandle HandleOf( Socket& socket )
+	{
+		uint32 index = IndexOf(socket.Descriptor());
+		if( index < slots.size() && slots[index].used == true )
+			return ConnectionHandle(index, slots[index].generation);
+		return ConnectionHandle();
+	}
+
+	//closes the socket, returns false when the handle was stale
+	bool Remove( ConnectionHandle handle )
+	{
+		Slot* slot = Get(handle);
+		if( slot == 0x0 )
+			return false;
+		slot->socket.Close();
+		Retire(*slot);
+		return true;
+	}
+
+	int32 Count()
+	{
+		return count;
+	}
+
+private:
+	struct Slot
+	{
+		uint32	generation;
+		bool	used;
+		T		value;
+		Socket	socket;
+		Slot() : generation(1), used(false), value() { }
+	};
+
+	std::vector<Slot> slots;
+	int32 count;
+
+	static uint32 IndexOf( int64 descriptor )
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		//socket handles are multiples of four
+		return (uint32)(descriptor >> 2);
+		#else
+		return (uint32)descriptor;
+		#endif
+	}
+
+	Slot* Get( ConnectionHandle handle )
+	{
+		if( handle.index >= slots.size() )
+			return 0x0;
+		Slot& slot = slots[handle.index];
+		return slot.used == true && slot.generation == handle.generation ? &slot : 0x0;
+	}
+
+	void Retire( Slot& slot )
+	{
+		slot.used = false;
+		slot.value = T();
+		//0 is skipped when the generation wraps around 32 bits, uint32 may be wider
+		if( (++slot.generation & 0xffffffff) == 0 )
+			slot.generation = 1;
+		count--;
+	}
+
+	ConnectionTable(const ConnectionTable&);
+	ConnectionTable& operator=(const ConnectionTable&);
+};
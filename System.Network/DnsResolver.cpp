@@ -0,0 +1,377 @@
+#include "DnsResolver.h"
+#include "NetworkImpl.h"
+#include "Threading.h"
+#include <algorithm>
+#include <cctype>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+namespace
+{
+	//failures are cached for at most this many milliseconds
+	const int NegativeTtl = 5000;
+	//names asked for within the last tenth of their ttl are refreshed ahead of expiry
+	const int RefreshFraction = 10;
+	//past this many names the expired ones are swept
+	const size_t SweepThreshold = 1024;
+
+	struct ResolveResult : IAsyncResult
+	{
+		SocketIOManager&		manager;
+		AsyncCallback			callback;
+		void*					state;
+		std::vector<IPAdress>	addresses;
+		std::string				error;
+		bool					completed;
+		Mutex					mutex;
+		Condition				condition;
+
+		ResolveResult(SocketIOManager& m, AsyncCallback c, void* s) : manager(m), callback(c), state(s), completed(false) { }
+
+		SocketIOManager& Manager()	{ return manager; }
+		void* AsyncState()			{ return state; }
+		bool IsCompleted()
+		{
+			ScopedLock lock(mutex);
+			return completed;
+		}
+
+		void Complete(const std::vector<IPAdress>& a, const std::string& e)
+		{
+			//without a callback the waiter may release the result as soon as it completed
+			AsyncCallback completion = callback;
+			{
+				ScopedLock lock(mutex);
+				addresses = a;
+				error = e;
+				completed = true;
+				condition.Broadcast();
+			}
+			if( completion != 0x0 )
+				completion(this);
+		}
+	};
+
+	struct Lookup
+	{
+		std::vector<IPAdress>	addresses;
+		//failure of the last lookup, empty when addresses holds its result
+		std::string				error;
+		uint64					expires;
+		bool					resolving;
+		std::vector<ResolveResult*> waiters;
+		Lookup() : expires(0), resolving(false) { }
+	};
+
+	std::string Lower(const std::string& name)
+	{
+		std::string lower(name);
+		for( size_t i = 0; i < lower.size(); i++ )
+			lower[i] = (char)tolower((unsigned char)lower[i]);
+		return lower;
+	}
+}
+
+const char* SystemResolverSource::Lookup( const char* hostname, std::vector<IPAdress>& addresses, int& ttl )
+{
+	addrinfo hints; addrinfo* addr; int result = 0;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	if((result = getaddrinfo(hostname, 0, &hints, &addr)) != 0) {
+		#if PLATFORM == PLATFORM_WIN32
+		return resolveError(WSAGetLastError());
+		#elif PLATFORM == PLATFORM_LINUX
+		return gai_strerror(result);
+		#endif
+	}
+
+	for( addrinfo* it = addr; it != 0x0; it = it->ai_next ) {
+		IPAdress adress(((sockaddr_in*)it->ai_addr)->sin_addr.s_addr);
+		bool duplicate = false;
+		for( size_t i = 0; i < addresses.size() && duplicate == false; i++ )
+			duplicate = addresses[i].adress == adress.adress;
+		if( duplicate == false )
+			addresses.push_back(adress);
+	}
+	freeaddrinfo(addr);
+	return 0x0;
+}
+
+struct HostsResolverSource::Impl
+{
+	std::map<std::string, std::vector<IPAdress> > hosts;
+};
+
+HostsResolverSource::HostsResolverSource( const char* path )
+{
+	m_impl = new Impl();
+	std::ifstream file(path);
+	if( !file ) {
+		delete m_impl;
+		throw SocketException("Unable to open the hosts file.");
+	}
+
+	//address followed by its names, # starts a comment, IPv6 entries are skipped
+	std::string line;
+	while( std::getline(file, line) ) {
+		std::string::size_type comment = line.find('#');
+		if( comment != std::string::npos )
+			line.erase(comment);
+
+		std::istringstream fields(line);
+		std::string adress, name;
+		if( !(fields >> adress) || adress.find(':') != std::string::npos )
+			continue;
+		IPAdress parsed = IPAdress::Parse(adress.c_str());
+		if( parsed.adress == IPAdress::None.adress && adress != "255.255.255.255" )
+			continue;
+		while( fields >> name )
+			m_impl->hosts[Lower(name)].push_back(parsed);
+	}
+}
+
+HostsResolverSource::~HostsResolverSource()
+{
+	delete m_impl;
+}
+
+const char* HostsResolverSource::Lookup( const char* hostname, std::vector<IPAdress>& addresses, int& ttl )
+{
+	std::map<std::string, std::vector<IPAdress> >::iterator it = m_impl->hosts.find(Lower(hostname));
+	if( it == m_impl->hosts.end() ) {
+		return "The host is not listed in the hosts file.";
+	}
+	addresses = it->second;
+	return 0x0;
+}
+
+struct DnsResolver::Impl
+{
+	ResolverSource*			source;
+	SystemResolverSource	system;
+	int						ttl;
+	Mutex					mutex;
+	Condition				condition;
+	bool					running;
+	std::map<std::string, Lookup> cache;
+	//names waiting for a resolver thread
+	std::deque<std::string>	queue;
+	std::vector<Thread*>	threads;
+
+	void Start(int count)
+	{
+		running = true;
+		for( int i = 0; i < count; i++ ) {
+			threads.push_back(new Thread());
+			if( threads.back()->Start(&Run, this) == false ) {
+				Shutdown();
+				throw SocketException("Unable to start the resolver thread.");
+			}
+		}
+	}
+
+	void Shutdown()
+	{
+		{
+			ScopedLock lock(mutex);
+			running = false;
+			condition.Broadcast();
+		}
+		for( size_t i = 0; i < threads.size(); i++ ) {
+			threads[i]->Join();
+			delete threads[i];
+		}
+		threads.clear();
+
+		std::vector<ResolveResult*> waiters;
+		for( std::map<std::string, Lookup>::iterator it = cache.begin(); it != cache.end(); ++it )
+			waiters.insert(waiters.end(), it->second.waiters.begin(), it->second.waiters.end());
+		cache.clear();
+		for( size_t i = 0; i < waiters.size(); i++ )
+			waiters[i]->Complete(std::vector<IPAdress>(), "The resolver was shut down.");
+	}
+
+	//queues the name for a resolver thread unless a lookup is already in flight, lock must be held
+	void Queue(const std::string& hostname, Lookup& lookup)
+	{
+		if( lookup.resolving == false ) {
+			lookup.resolving = true;
+			queue.push_back(hostname);
+			condition.Signal();
+		}
+	}
+
+	//lock must be held
+	void Sweep(uint64 now)
+	{
+		for( std::map<std::string, Lookup>::iterator it = cache.begin(); it != cache.end(); ) {
+			if( it->second.expires <= now && it->second.resolving == false && it->second.waiters.empty() == true )
+				cache.erase(it++);
+			else
+				++it;
+		}
+	}
+
+	static void Run(void* argument)
+	{
+		Impl* impl = reinterpret_cast<Impl*>(argument);
+		ScopedLock lock(impl->mutex);
+		for( ;; ) {
+			while( impl->running == true && impl->queue.empty() == true )
+				impl->condition.Wait(impl->mutex);
+			if( impl->running == false )
+				return;
+
+			std::string hostname = impl->queue.front();
+			impl->queue.pop_front();
+			std::vector<IPAdress> addresses;
+			int ttl = impl->ttl;
+
+			impl->mutex.Unlock();
+			const char* failure = impl->source->Lookup(hostname.c_str(), addresses, ttl);
+			if( failure == 0x0 && addresses.empty() == true )
+				failure = "The host has no IPv4 address.";
+			impl->mutex.Lock();
+
+			uint64 now = Milliseconds();
+			Lookup& lookup = impl->cache[hostname];
+			lookup.resolving = false;
+			if( failure == 0x0 ) {
+				lookup.addresses = addresses;
+				lookup.error.clear();
+				lookup.expires = now + ttl;
+			} else if( lookup.error.empty() == false || lookup.addresses.empty() == true || now >= lookup.expires ) {
+				//a failed refresh keeps serving the addresses until they expire
+				lookup.addresses.clear();
+				lookup.error = failure;
+				lookup.expires = now + std::min(ttl, NegativeTtl);
+			}
+
+			std::vector<ResolveResult*> waiters;
+			waiters.swap(lookup.waiters);
+			addresses = lookup.addresses;
+			std::string error = lookup.error;
+			if( impl->cache.size() > SweepThreshold )
+				impl->Sweep(now);
+
+			impl->mutex.Unlock();
+			for( size_t i = 0; i < waiters.size(); i++ )
+				waiters[i]->Complete(addresses, error);
+			impl->mutex.Lock();
+		}
+	}
+};
+
+DnsResolver& DnsResolver::Default()
+{
+	static DnsResolver resolver;
+	return resolver;
+}
+
+DnsResolver::DnsResolver()
+{
+	m_impl = new Impl();
+	m_impl->source = &m_impl->system;
+	m_impl->ttl = 30000;
+	try {
+		m_impl->Start(2);
+	} catch( SocketException& ) {
+		delete m_impl;
+		throw;
+	}
+}
+
+DnsResolver::DnsResolver( ResolverSource& source, int threads, int ttl )
+{
+	if( threads < 1 ) {
+		throw SocketException("Argument threads is out of range.");
+	}
+	if( ttl < 0 ) {
+		throw SocketException("Argument ttl is out of range.");
+	}
+
+	m_impl = new Impl();
+	m_impl->source = &source;
+	m_impl->ttl = ttl;
+	try {
+		m_impl->Start(threads);
+	} catch( SocketException& ) {
+		delete m_impl;
+		throw;
+	}
+}
+
+DnsResolver::~DnsResolver()
+{
+	m_impl->Shutdown();
+	delete m_impl;
+}
+
+void DnsResolver::GetHostAddresses( const char* hostname, std::vector<IPAdress>& addresses )
+{
+	EndGetHostAddresses(BeginGetHostAddresses(hostname, 0x0, 0x0), addresses);
+}
+
+IAsyncResult* DnsResolver::BeginGetHostAddresses( const char* hostname, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	ResolveResult* result = new ResolveResult(manager, callback, state);
+	std::vector<IPAdress> addresses;
+	std::string error;
+	bool cached = false;
+	{
+		ScopedLock lock(m_impl->mutex);
+		//host names ignore case, spellings of one name share its entry and its query
+		std::string name = Lower(hostname);
+		Lookup& lookup = m_impl->cache[name];
+		uint64 now = Milliseconds();
+		if( now < lookup.expires ) {
+			cached = true;
+			addresses = lookup.addresses;
+			error = lookup.error;
+			if( error.empty() == true && lookup.expires - now < (uint64)(m_impl->ttl / RefreshFraction) )
+				m_impl->Queue(name, lookup);
+		} else {
+			lookup.waiters.push_back(result);
+			m_impl->Queue(name, lookup);
+		}
+	}
+
+	if( cached == true )
+		result->Complete(addresses, error);
+	return result;
+}
+
+void DnsResolver::EndGetHostAddresses( IAsyncResult* asyncResult, std::vector<IPAdress>& addresses )
+{
+	ResolveResult* result = static_cast<ResolveResult*>(asyncResult);
+	std::string error;
+	{
+		ScopedLock lock(result->mutex);
+		while( result->completed == false )
+			result->condition.Wait(result->mutex);
+		addresses = result->addresses;
+		error = result->error;
+	}
+	delete result;
+
+	if( error.empty() == false ) {
+		throw SocketException(error.c_str());
+	}
+}
+
+void DnsResolver::Flush()
+{
+	ScopedLock lock(m_impl->mutex);
+	for( std::map<std::string, Lookup>::iterator it = m_impl->cache.begin(); it != m_impl->cache.end(); ) {
+		if( it->second.resolving == false ) {
+			m_impl->cache.erase(it++);
+		} else {
+			it->second.expires = 0;
+			++it;
+		}
+	}
+}
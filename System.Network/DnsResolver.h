@@ -0,0 +1,61 @@
+#pragma once
+#include "Network.h"
+#include <vector>
+
+//where DnsResolver looks names up
+struct ResolverSource
+{
+	virtual ~ResolverSource() { }
+	//fills the IPv4 addresses of the host and may lower ttl (milliseconds), returns 0x0 or a description of the failure
+	virtual const char* Lookup( const char* hostname, std::vector<IPAdress>& addresses, int& ttl ) = 0;
+};
+
+//getaddrinfo, which does not report record lifetimes so the resolver's ttl applies
+struct SystemResolverSource : ResolverSource
+{
+	const char* Lookup( const char* hostname, std::vector<IPAdress>& addresses, int& ttl );
+};
+
+//a hosts file, read once when constructed
+struct HostsResolverSource : ResolverSource
+{
+	struct Impl;
+	Impl* m_impl;
+
+	HostsResolverSource( const char* path );
+	~HostsResolverSource();
+	const char* Lookup( const char* hostname, std::vector<IPAdress>& addresses, int& ttl );
+
+private:
+	HostsResolverSource(const HostsResolverSource&);
+	HostsResolverSource& operator=(const HostsResolverSource&);
+};
+
+/*
+	Resolves host names on its own threads and caches every address of a
+	name for ttl milliseconds, failures for a few seconds. Concurrent
+	lookups of the same name share a single query, and names that are
+	still in use shortly before they expire are refreshed in the background
+	so that callers keep hitting the cache. Cache hits complete inline.
+*/
+struct DnsResolver
+{
+	struct Impl;
+	Impl* m_impl;
+
+	static DnsResolver& Default();
+
+	DnsResolver();
+	DnsResolver( ResolverSource& source, int threads, int ttl );
+	~DnsResolver();
+
+	void GetHostAddresses( const char* hostname, std::vector<IPAdress>& addresses );
+	IAsyncResult* BeginGetHostAddresses( const char* hostname, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	void EndGetHostAddresses( IAsyncResult* result, std::vector<IPAdress>& addresses );
+	//forgets every cached name
+	void Flush();
+
+private:
+	DnsResolver(const DnsResolver&);
+	DnsResolver& operator=(const DnsResolver&);
+};
@@ -0,0 +1,781 @@
+#include "EpollIOManager.h"
+
+#if PLATFORM == PLATFORM_LINUX
+#include "AsyncResult.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/errqueue.h>
+#include <vector>
+
+namespace
+{
+	struct Loop;
+
+	struct Entry
+	{
+		Mutex	mutex;
+		SOCKET	socket;
+		Loop*	loop;
+		bool	closed;
+		//id of the next zero-copy notification, ids below acknowledged were released
+		unsigned	sequence;
+		unsigned	acknowledged;
+		//sends and connects wait for writability, receives and accepts for readability
+		ResultQueue<SocketAsyncResult> sends;
+		ResultQueue<SocketAsyncResult> receives;
+		//zero-copy sends waiting for the kernel to release their buffers
+		ResultQueue<SocketAsyncResult> releases;
+		//deadline timers by TimerKind and the deadline each is filed for, 0 while it is not
+		TimerWheel::Timer timers[TimerKind::Expiry];
+		uint64	due[TimerKind::Expiry];
+		int		idleTimeout;
+		//when the socket last saw traffic or an operation was begun
+		uint64	activity;
+		//of the socket while it is tracked by IOStatistics, reset when it is detached
+		SocketCounters* counters;
+		Entry(SOCKET s, Loop* l) : socket(s), loop(l), closed(false), sequence(0), acknowledged(0), idleTimeout(0), activity(0), counters(0x0)
+		{
+			for( int i = 0; i < TimerKind::Expiry; i++ ) {
+				timers[i].kind = i;
+				timers[i].context = this;
+				due[i] = 0;
+			}
+		}
+	};
+
+	struct Posted
+	{
+		EpollIOManager::Task	task;
+		void*					state;
+	};
+
+	struct Loop
+	{
+		int		epoll;
+		int		wakeup;
+		bool	running;
+		Thread	thread;
+		Mutex	mutex;
+		//entries detached while the loop may still hold events for them
+		std::vector<Entry*> garbage;
+		//callbacks handed over by Begin calls nested too deep
+		Completions deferred;
+		//tasks handed over by Post, swapped with draining by the loop so neither reallocates
+		std::vector<Posted> posted;
+		std::vector<Posted> draining;
+		//timers and socket deadlines, the loop wakes up on its own at wake
+		TimerWheel wheel;
+		uint64	wake;
+		std::vector<TimerWheel::Timer*> expired;
+		Loop() : wheel(Milliseconds()), wake((uint64)-1) { }
+	};
+
+	//entry lock must be held
+	void ProgressReceive(Entry* entry, Completions& completions)
+	{
+		while( entry->receives.Empty() == false ) {
+			SocketAsyncResult* result = entry->receives.Front();
+			if( result->operation == SocketOperation::Accept ) {
+				//the whole backlog is drained on a single readiness notification
+				int error = AcceptPending(entry->socket, result);
+				if( result->acceptedCount > 0 ) {
+					error = 0;
+				} else if( error == EAGAIN || error == EWOULDBLOCK ) {
+					return;
+				}
+
+				entry->receives.Pop();
+				Complete(completions, result, error);
+				continue;
+			}
+
+			ssize_t length;
+			if( result->sliceCount > 0 ) {
+				msghdr message;
+				memset(&message, 0, sizeof(message));
+				message.msg_iov = result->Pending();
+				message.msg_iovlen = result->PendingCount();
+				length = recvmsg(entry->socket, &message, 0);
+			} else {
+				length = recv(entry->socket, (char*)result->buffer, result->size, 0);
+			}
+			countReceive(entry->counters, length, length == SOCKET_ERROR ? errno : 0);
+			if( length == SOCKET_ERROR ) {
+				if( errno == EINTR )
+					continue;
+				if( errno == EAGAIN || errno == EWOULDBLOCK )
+					return;
+				entry->receives.Pop();
+				Complete(completions, result, errno);
+				continue;
+			}
+
+			entry->receives.Pop();
+			result->Advance((int32)length);
+			Complete(completions, result, 0);
+		}
+	}
+
+	//completes a send unless the kernel still references its buffer, entry lock must be held
+	void FinishSend(Entry* entry, SocketAsyncResult* result, int error, Completions& completions)
+	{
+		if( result->notifications > 0 && (int)(result->sequence - entry->acknowledged) >= 0 ) {
+			result->error = error;
+			entry->releases.Push(result);
+		} else {
+			Complete(completions, result, error);
+		}
+	}
+
+	//entry lock must be held
+	void ProgressSend(Entry* entry, Completions& completions)
+	{
+		while( entry->sends.Empty() == false ) {
+			SocketAsyncResult* result = entry->sends.Front();
+			if( result->operation == SocketOperation::Connect ) {
+				int error = 0; socklen_t length = sizeof(error);
+				if( getsockopt(entry->socket, SOL_SOCKET, SO_ERROR, (char*)&error, &length) != 0 ) {
+					error = errno;
+				}
+				if( error == 0 ) {
+					sockaddr_in remote; socklen_t remoteLength = sizeof(remote);
+					if( getpeername(entry->socket, (sockaddr*)&remote, &remoteLength) != 0 ) {
+						//still in progress, writability was not caused by the connect
+						if( errno == ENOTCONN )
+							return;
+						error = errno;
+					}
+				}
+
+				entry->sends.Pop();
+				Complete(completions, result, error);
+				continue;
+			}
+
+			ssize_t length;
+			if( result->sliceCount > 0 ) {
+				msghdr message;
+				memset(&message, 0, sizeof(message));
+				message.msg_iov = result->Pending();
+				message.msg_iovlen = result->PendingCount();
+				length = sendmsg(entry->socket, &message, MSG_NOSIGNAL | (result->zeroCopy ? MSG_ZEROCOPY : 0));
+			} else {
+				length = send(entry->socket, (char*)(result->buffer + result->transferred), result->size - result->transferred, MSG_NOSIGNAL | (result->zeroCopy ? MSG_ZEROCOPY : 0));
+			}
+			countSend(entry->counters, length, result->size - result->transferred, length == SOCKET_ERROR ? errno : 0);
+			if( length == SOCKET_ERROR ) {
+				if( errno == EINTR )
+					continue;
+				if( errno == EAGAIN || errno == EWOULDBLOCK )
+					return;
+				entry->sends.Pop();
+				FinishSend(entry, result, errno, completions);
+				continue;
+			}
+
+			//every successful zero-copy call is acknowledged with the next id
+			if( result->zeroCopy == true ) {
+				result->sequence = entry->sequence++;
+				result->notifications = 1;
+			}
+			result->Advance((int32)length);
+			if( result->transferred == result->size ) {
+				entry->sends.Pop();
+				FinishSend(entry, result, 0, completions);
+			}
+		}
+	}
+
+	//reads the zero-copy notifications from the error queue, entry lock must be held
+	void ProgressRelease(Entry* entry, Completions& completions)
+	{
+		for( ;; ) {
+			union { char buffer[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in))]; cmsghdr align; } control;
+			msghdr message;
+			memset(&message, 0, sizeof(message));
+			message.msg_control = control.buffer;
+			message.msg_controllen = sizeof(control.buffer);
+			if( recvmsg(entry->socket, &message, MSG_ERRQUEUE) == SOCKET_ERROR ) {
+				if( errno == EINTR )
+					continue;
+				return;
+			}
+
+			for( cmsghdr* header = CMSG_FIRSTHDR(&message); header != 0x0; header = CMSG_NXTHDR(&message, header) ) {
+				if( header->cmsg_level != SOL_IP || header->cmsg_type != IP_RECVERR )
+					continue;
+				sock_extended_err* notification = reinterpret_cast<sock_extended_err*>(CMSG_DATA(header));
+				if( notification->ee_errno != 0 || notification->ee_origin != SO_EE_ORIGIN_ZEROCOPY )
+					continue;
+
+				//ids ee_info up to ee_data were released, sends are acknowledged in order
+				if( (int)(notification->ee_data + 1 - entry->acknowledged) > 0 )
+					entry->acknowledged = notification->ee_data + 1;
+				while( entry->releases.Empty() == false && (int)(entry->releases.Front()->sequence - entry->acknowledged) < 0 ) {
+					SocketAsyncResult* result = entry->releases.Pop();
+					Complete(completions, result, result->error);
+				}
+			}
+		}
+	}
+
+	//entry lock must be held
+	void Cancel(Entry* entry, Completions& completions)
+	{
+		while( entry->receives.Empty() == false )
+			Complete(completions, entry->receives.Pop(), ECANCELED);
+		while( entry->sends.Empty() == false )
+			Complete(completions, entry->sends.Pop(), ECANCELED);
+		while( entry->releases.Empty() == false )
+			Complete(completions, entry->releases.Pop(), ECANCELED);
+	}
+
+	void Wakeup(Loop* loop)
+	{
+		uint64_t value = 1;
+		if( write(loop->wakeup, &value, sizeof(value)) < 0 ) { }
+	}
+
+	//files the timer and wakes the loop when it is due before the loop wakes up anyway, loop lock must be held
+	void File(Loop* loop, TimerWheel::Timer* timer, uint64 deadline)
+	{
+		loop->wheel.Schedule(timer, deadline);
+		if( deadline < loop->wake ) {
+			loop->wake = deadline;
+			Wakeup(loop);
+		}
+	}
+
+	//files the deadline timer of the entry unless it is filed for an earlier deadline already,
+	//the timer is not moved back when operations complete but checks what is left when it expires,
+	//entry lock must be held
+	void Arm(Entry* entry, int kind, uint64 deadline)
+	{
+		if( deadline == 0 || entry->closed == true || (entry->due[kind] != 0 && entry->due[kind] <= deadline) )
+			return;
+		entry->due[kind] = deadline;
+		ScopedLock lock(entry->loop->mutex);
+		File(entry->loop, &entry->timers[kind], deadline);
+	}
+
+	//stamps the deadline of an operation left pending by its first attempt, entry lock must be held
+	void Watch(Entry* entry, SocketAsyncResult* result, TimerKind::Enum kind, Socket& socket)
+	{
+		Socket::Impl* impl = reinterpret_cast<Socket::Impl*>(&socket.m_impl);
+		int timeout = kind == TimerKind::Receive ? impl->receiveTimeout : impl->sendTimeout;
+		entry->idleTimeout = impl->idleTimeout;
+		if( timeout == 0 && entry->idleTimeout == 0 )
+			return;
+
+		uint64 now = Milliseconds();
+		result->deadline = DeadlineOf(timeout, now);
+		Arm(entry, kind, result->deadline);
+		entry->activity = now;
+		Arm(entry, TimerKind::Idle, DeadlineOf(entry->idleTimeout, now));
+	}
+
+	//completes a pending operation with ETIMEDOUT, entry lock must be held
+	void TimeOut(Entry* entry, SocketAsyncResult* result, Completions& completions)
+	{
+		if( result->operation == SocketOperation::Send )
+			FinishSend(entry, result, ETIMEDOUT, completions);
+		else
+			Complete(completions, result, ETIMEDOUT);
+	}
+
+	//times out the operations of the queue past their deadline, returns the earliest deadline left or 0
+	uint64 Expire(Entry* entry, ResultQueue<SocketAsyncResult>& queue, uint64 now, Completions& completions)
+	{
+		uint64 next = 0;
+		for( SocketAsyncResult* result = queue.Front(); result != 0x0; ) {
+			SocketAsyncResult* following = queue.Next(result);
+			if( result->deadline != 0 && result->deadline <= now ) {
+				queue.Remove(result);
+				TimeOut(entry, result, completions);
+			} else if( result->deadline != 0 && (next == 0 || result->deadline < next) ) {
+				next = result->deadline;
+			}
+			result = following;
+		}
+		return next;
+	}
+
+	//handles an expired deadline timer of the entry on its loop, which is the only thread deleting entries
+	void Expire(Entry* entry, int kind, uint64 now, Completions& completions)
+	{
+		ScopedLock lock(entry->mutex);
+		entry->due[kind] = 0;
+		if( entry->closed == true )
+			return;
+
+		uint64 next = 0;
+		if( kind == TimerKind::Receive ) {
+			next = Expire(entry, entry->receives, now, completions);
+		} else if( kind == TimerKind::Send ) {
+			next = Expire(entry, entry->sends, now, completions);
+		} else if( entry->idleTimeout > 0 && (entry->receives.Empty() == false || entry->sends.Empty() == false) ) {
+			if( now >= entry->activity + entry->idleTimeout ) {
+				while( entry->receives.Empty() == false )
+					TimeOut(entry, entry->receives.Pop(), completions);
+				while( entry->sends.Empty() == false )
+					TimeOut(entry, entry->sends.Pop(), completions);
+			} else {
+				next = entry->activity + entry->idleTimeout;
+			}
+		}
+		Arm(entry, kind, next);
+	}
+
+	//invokes the callbacks of operations completed by a Begin call
+	void Finish(Loop* loop, Completions& completions)
+	{
+		if( completions.Empty() == true )
+			return;
+
+		if( InlineDepth() < MaxInlineDepth ) {
+			Dispatch(completions);
+		} else {
+			ScopedLock lock(loop->mutex);
+			loop->deferred.Append(completions);
+			Wakeup(loop);
+		}
+	}
+
+	void CollectGarbage(Loop* loop, Completions& deferred)
+	{
+		ScopedLock lock(loop->mutex);
+		for( size_t i = 0; i < loop->garbage.size(); i++ )
+			delete loop->garbage[i];
+		loop->garbage.clear();
+		deferred.Append(loop->deferred);
+	}
+
+	//runs the tasks posted so far, the ones they post run on the next turn
+	void RunPosted(Loop* loop)
+	{
+		{
+			ScopedLock lock(loop->mutex);
+			loop->draining.swap(loop->posted);
+		}
+		for( size_t i = 0; i < loop->draining.size(); i++ )
+			loop->draining[i].task(loop->draining[i].state);
+		loop->draining.clear();
+	}
+
+	//completes the expired timers and deadlines, returns the milliseconds until the wheel is due again or -1
+	int ExpireTimers(Loop* loop, Completions& completions)
+	{
+		uint64 now = Milliseconds();
+		{
+			ScopedLock lock(loop->mutex);
+			loop->wheel.Advance(now, loop->expired);
+		}
+
+		//entry locks are taken before the loop lock, the expired timers are handled without it
+		for( size_t i = 0; i < loop->expired.size(); i++ ) {
+			TimerWheel::Timer* timer = loop->expired[i];
+			if( timer->kind == TimerKind::Expiry )
+				Complete(completions, reinterpret_cast<SocketAsyncResult*>(timer->context), 0);
+			else
+				Expire(reinterpret_cast<Entry*>(timer->context), timer->kind, now, completions);
+		}
+		loop->expired.clear();
+
+		ScopedLock lock(loop->mutex);
+		int timeout = loop->wheel.Timeout(now);
+		loop->wake = timeout < 0 ? (uint64)-1 : now + timeout;
+		return timeout;
+	}
+
+	void Run(void* argument)
+	{
+		Loop* loop = reinterpret_cast<Loop*>(argument);
+		Completions completions;
+		epoll_event events[256];
+		for( ;; ) {
+			//events of a detached entry can only be pending within a single batch
+			CollectGarbage(loop, completions);
+			int timeout = ExpireTimers(loop, completions);
+			Dispatch(completions);
+			RunPosted(loop);
+
+			int count = epoll_wait(loop->epoll, events, 256, timeout);
+			if( count == SOCKET_ERROR ) {
+				if( errno == EINTR )
+					continue;
+				return;
+			}
+			uint64 now = Milliseconds();
+
+			for( int i = 0; i < count; i++ ) {
+				Entry* entry = reinterpret_cast<Entry*>(events[i].data.ptr);
+				if( entry == 0x0 ) {
+					uint64_t value;
+					if( read(loop->wakeup, &value, sizeof(value)) < 0 ) { }
+					if( loop->running == false )
+						return;
+					continue;
+				}
+
+				{
+					ScopedLock lock(entry->mutex);
+					if( entry->closed == true )
+						continue;
+					entry->activity = now;
+					if( events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR) )
+						ProgressReceive(entry, completions);
+					if( events[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR) )
+						ProgressSend(entry, completions);
+					if( events[i].events & EPOLLERR )
+						ProgressRelease(entry, completions);
+				}
+				Dispatch(completions);
+			}
+		}
+	}
+}
+
+struct EpollIOManager::Impl
+{
+	Mutex				mutex;
+	std::vector<Loop*>	loops;
+	//entries indexed by descriptor
+	std::vector<Entry*>	entries;
+	size_t				next;
+
+	Impl(int threads) : next(0)
+	{
+		for( int i = 0; i < threads; i++ ) {
+			Loop* loop = new Loop();
+			loop->running = true;
+			loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+			loop->wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			loops.push_back(loop);
+			if( loop->epoll == SOCKET_ERROR || loop->wakeup == SOCKET_ERROR ) {
+				int errorCode = errno;
+				Shutdown();
+				throw SocketException(resolveError(errorCode));
+			}
+
+			epoll_event event;
+			event.events = EPOLLIN;
+			event.data.ptr = 0x0;
+			epoll_ctl(loop->epoll, EPOLL_CTL_ADD, loop->wakeup, &event);
+			if( loop->thread.Start(&Run, loop) == false ) {
+				Shutdown();
+				throw SocketException("Unable to start the event loop thread.");
+			}
+		}
+	}
+
+	void Shutdown()
+	{
+		Completions completions;
+		for( size_t i = 0; i < loops.size(); i++ ) {
+			Loop* loop = loops[i];
+			loop->running = false;
+			if( loop->wakeup != SOCKET_ERROR ) Wakeup(loop);
+			loop->thread.Join();
+			CollectGarbage(loop, completions);
+			std::vector<TimerWheel::Timer*> timers;
+			loop->wheel.Clear(timers);
+			for( size_t j = 0; j < timers.size(); j++ ) {
+				if( timers[j]->kind == TimerKind::Expiry )
+					Complete(completions, reinterpret_cast<SocketAsyncResult*>(timers[j]->context), ECANCELED);
+			}
+			if( loop->epoll != SOCKET_ERROR ) close(loop->epoll);
+			if( loop->wakeup != SOCKET_ERROR ) close(loop->wakeup);
+			delete loop;
+		}
+		loops.clear();
+
+		for( size_t i = 0; i < entries.size(); i++ ) {
+			if( entries[i] != 0x0 ) {
+				{
+					ScopedLock lock(entries[i]->mutex);
+					Cancel(entries[i], completions);
+				}
+				delete entries[i];
+			}
+		}
+		entries.clear();
+		Dispatch(completions);
+	}
+
+	Entry* Register(Socket& socket)
+	{
+		SOCKET descriptor = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->socket;
+		if( descriptor == INVALID_SOCKET ) {
+			throw SocketException("The socket is not valid.");
+		}
+
+		SocketCounters* counters = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->counters;
+		ScopedLock lock(mutex);
+		if( (size_t)descriptor < entries.size() && entries[descriptor] != 0x0 ) {
+			Entry* entry = entries[descriptor];
+			//the socket was tracked after its first operation
+			if( entry->counters != counters ) {
+				ScopedLock entryLock(entry->mutex);
+				entry->counters = counters;
+			}
+			return entry;
+		}
+
+		socket.Blocking(false);
+		Entry* entry = new Entry(descriptor, loops[next++ % loops.size()]);
+		entry->counters = counters;
+		epoll_event event;
+		event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		event.data.ptr = entry;
+		if( epoll_ctl(entry->loop->epoll, EPOLL_CTL_ADD, descriptor, &event) != 0 ) {
+			int errorCode = errno;
+			delete entry;
+			throw SocketException(resolveError(errorCode));
+		}
+
+		if( entries.size() <= (size_t)descriptor ) {
+			entries.resize(descriptor + 1, 0x0);
+		}
+		entries[descriptor] = entry;
+		return entry;
+	}
+};
+
+EpollIOManager::EpollIOManager()
+{
+	m_impl = new Impl(1);
+}
+
+EpollIOManager::EpollIOManager(int threads)
+{
+	if( threads < 1 ) {
+		throw SocketException("Argument threads is out of range.");
+	}
+	m_impl = new Impl(threads);
+}
+
+EpollIOManager::~EpollIOManager()
+{
+	m_impl->Shutdown();
+	delete m_impl;
+}
+
+IAsyncResult* EpollIOManager::BeginTimer( int milliSeconds, AsyncCallback callback, void* state )
+{
+	if( milliSeconds < 0 ) {
+		throw SocketException("Argument milliSeconds is out of range.");
+	}
+
+	Loop* loop = 0x0;
+	{
+		ScopedLock lock(m_impl->mutex);
+		loop = m_impl->loops[m_impl->next++ % m_impl->loops.size()];
+	}
+	SocketAsyncResult* result = new SocketAsyncResult(*this, SocketOperation::Timer, 0x0, 0, callback, state);
+	result->timer.kind = TimerKind::Expiry;
+	result->timer.context = result;
+
+	ScopedLock lock(loop->mutex);
+	File(loop, &result->timer, Milliseconds() + milliSeconds);
+	return result;
+}
+
+void EpollIOManager::EndTimer( IAsyncResult* result )
+{
+	SocketAsyncResult::End(result);
+}
+
+void EpollIOManager::Post( Task task, void* state )
+{
+	Loop* loop = 0x0;
+	{
+		ScopedLock lock(m_impl->mutex);
+		loop = m_impl->loops[m_impl->next++ % m_impl->loops.size()];
+	}
+	Posted posted;
+	posted.task = task;
+	posted.state = state;
+
+	//only the first task of a turn has to wake the loop, it takes all of them
+	ScopedLock lock(loop->mutex);
+	loop->posted.push_back(posted);
+	if( loop->posted.size() == 1 )
+		Wakeup(loop);
+}
+
+IAsyncResult* EpollIOManager::BeginSend( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	SocketAsyncResult* result = new SocketAsyncResult(*this, SocketOperation::Send, buffer + offset, size, callback, state);
+	result->zeroCopy = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->zeroCopy == 1;
+
+	Loop* loop = entry->loop;
+	Completions completions;
+	{
+		ScopedLock lock(entry->mutex);
+		entry->sends.Push(result);
+		ProgressSend(entry, completions);
+		if( entry->sends.Back() == result )
+			Watch(entry, result, TimerKind::Send, socket);
+	}
+	Finish(loop, completions);
+	return result;
+}
+
+IAsyncResult* EpollIOManager::BeginReceive( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	SocketAsyncResult* result = new SocketAsyncResult(*this, SocketOperation::Receive, buffer + offset, size, callback, state);
+
+	Loop* loop = entry->loop;
+	Completions completions;
+	{
+		ScopedLock lock(entry->mutex);
+		entry->receives.Push(result);
+		ProgressReceive(entry, completions);
+		if( entry->receives.Back() == result )
+			Watch(entry, result, TimerKind::Receive, socket);
+	}
+	Finish(loop, completions);
+	return result;
+}
+
+IAsyncResult* EpollIOManager::BeginSend( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	SocketAsyncResult* result = new SocketAsyncResult(*this, SocketOperation::Send, 0x0, 0, callback, state);
+	result->Gather(slices, count);
+	result->zeroCopy = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->zeroCopy == 1;
+
+	Loop* loop = entry->loop;
+	Completions completions;
+	{
+		ScopedLock lock(entry->mutex);
+		entry->sends.Push(result);
+		ProgressSend(entry, completions);
+		if( entry->sends.Back() == result )
+			Watch(entry, result, TimerKind::Send, socket);
+	}
+	Finish(loop, completions);
+	return result;
+}
+
+IAsyncResult* EpollIOManager::BeginReceive( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	SocketAsyncResult* result = new SocketAsyncResult(*this, SocketOperation::Receive, 0x0, 0, callback, state);
+	result->Gather(slices, count);
+
+	Loop* loop = entry->loop;
+	Completions completions;
+	{
+		ScopedLock lock(entry->mutex);
+		entry->receives.Push(result);
+		ProgressReceive(entry, completions);
+		if( entry->receives.Back() == result )
+			Watch(entry, result, TimerKind::Receive, socket);
+	}
+	Finish(loop, completions);
+	return result;
+}
+
+IAsyncResult* EpollIOManager::BeginAccept( Socket& socket, int32 capacity, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	SocketAsyncResult* result = new SocketAsyncResult(*this, SocketOperation::Accept, 0x0, capacity, callback, state);
+	result->Reserve(capacity);
+
+	Loop* loop = entry->loop;
+	Completions completions;
+	{
+		ScopedLock lock(entry->mutex);
+		entry->receives.Push(result);
+		ProgressReceive(entry, completions);
+		if( entry->receives.Back() == result )
+			Watch(entry, result, TimerKind::Receive, socket);
+	}
+	Finish(loop, completions);
+	return result;
+}
+
+IAsyncResult* EpollIOManager::BeginConnect( Socket& socket, const IPEndPoint& endPoint, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	SocketAsyncResult* result = new SocketAsyncResult(*this, SocketOperation::Connect, 0x0, 0, callback, state);
+	result->endPoint.sin_family = AF_INET;
+	result->endPoint.sin_addr.s_addr = (in_addr_t)endPoint.adress.adress;
+	result->endPoint.sin_port = htons(endPoint.port);
+
+	Loop* loop = entry->loop;
+	Completions completions;
+	{
+		ScopedLock lock(entry->mutex);
+		if( connect(entry->socket, (sockaddr*)&result->endPoint, sizeof(result->endPoint)) == 0 ) {
+			Complete(completions, result, 0);
+		} else if( errno != EINPROGRESS ) {
+			Complete(completions, result, errno);
+		} else {
+			entry->sends.Push(result);
+			ProgressSend(entry, completions);
+			if( entry->sends.Back() == result )
+				Watch(entry, result, TimerKind::Send, socket);
+		}
+	}
+	Finish(loop, completions);
+	return result;
+}
+
+int EpollIOManager::EndSend( IAsyncResult* result )
+{
+	return SocketAsyncResult::End(result);
+}
+
+int EpollIOManager::EndReceive( IAsyncResult* result )
+{
+	return SocketAsyncResult::End(result);
+}
+
+int EpollIOManager::EndAccept( IAsyncResult* result, Socket* accepted )
+{
+	return SocketAsyncResult::EndAccept(result, accepted);
+}
+
+void EpollIOManager::EndConnect( IAsyncResult* result )
+{
+	SocketAsyncResult::End(result);
+}
+
+void EpollIOManager::Detach( Socket& socket )
+{
+	SOCKET descriptor = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->socket;
+	Entry* entry = 0x0;
+	{
+		ScopedLock lock(m_impl->mutex);
+		if( descriptor == INVALID_SOCKET || (size_t)descriptor >= m_impl->entries.size() )
+			return;
+		entry = m_impl->entries[descriptor];
+		m_impl->entries[descriptor] = 0x0;
+	}
+
+	if( entry != 0x0 ) {
+		Completions completions;
+		epoll_ctl(entry->loop->epoll, EPOLL_CTL_DEL, descriptor, 0x0);
+		{
+			ScopedLock lock(entry->mutex);
+			entry->closed = true;
+			entry->counters = 0x0;
+			Cancel(entry, completions);
+		}
+
+		Loop* loop = entry->loop;
+		{
+			ScopedLock lock(loop->mutex);
+			for( int i = 0; i < TimerKind::Expiry; i++ )
+				loop->wheel.Cancel(&entry->timers[i]);
+			loop->garbage.push_back(entry);
+		}
+		Finish(loop, completions);
+	}
+}
+
+#endif
@@ -0,0 +1,47 @@
+#pragma once
+#include "Network.h"
+
+#if PLATFORM == PLATFORM_LINUX
+
+/*
+	Edge-triggered epoll implementation of SocketIOManager. Sockets are
+	spread round-robin over the event-loop threads on first use and switched
+	to non-blocking mode. Operations are attempted inline and otherwise
+	completed by the owning loop when the descriptor becomes ready.
+*/
+struct EpollIOManager : SocketIOManager
+{
+	typedef void (*Task)(void* state);
+
+	struct Impl;
+	Impl* m_impl;
+
+	EpollIOManager();
+	EpollIOManager(int threads);
+	~EpollIOManager();
+
+	IAsyncResult* BeginTimer( int milliSeconds, AsyncCallback callback, void* state );
+	void EndTimer( IAsyncResult* result );
+	//runs the task on a loop thread, picked round-robin like the timers, in the order posted;
+	//tasks still queued when the manager is destroyed are dropped
+	void Post( Task task, void* state );
+
+protected:
+	IAsyncResult* BeginSend( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state );
+	IAsyncResult* BeginReceive( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state );
+	IAsyncResult* BeginSend( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state );
+	IAsyncResult* BeginReceive( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state );
+	IAsyncResult* BeginAccept( Socket& socket, int32 capacity, AsyncCallback callback, void* state );
+	IAsyncResult* BeginConnect( Socket& socket, const IPEndPoint& endPoint, AsyncCallback callback, void* state );
+	int  EndSend( IAsyncResult* result );
+	int  EndReceive( IAsyncResult* result );
+	int  EndAccept( IAsyncResult* result, Socket* accepted );
+	void EndConnect( IAsyncResult* result );
+	void Detach( Socket& socket );
+
+private:
+	EpollIOManager(const EpollIOManager&);
+	EpollIOManager& operator=(const EpollIOManager&);
+};
+
+#endif
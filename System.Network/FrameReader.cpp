@@ -0,0 +1,222 @@
+#include "FrameReader.h"
+#include <string.h>
+#include <vector>
+
+struct FrameReader::Impl
+{
+	Socket&				socket;
+	FrameHeader::Enum	header;
+	uint8*				ring;
+	int32				capacity;
+	int32				maxFrame;
+	//stream positions, everything before consumed is free space and the frame
+	//last handed out lies between consumed and parsed
+	uint64				consumed;
+	uint64				parsed;
+	uint64				tail;
+	bool				filling;
+	//wrapped frames are copied here
+	std::vector<uint8>	scratch;
+
+	Impl(Socket& s) : socket(s) { }
+
+	uint8 At(uint64 position)
+	{
+		return ring[position % capacity];
+	}
+
+	//describes the free space, split in two where it wraps, returns the number of slices
+	int32 Free(IoSlice* slices)
+	{
+		int32 free = capacity - (int32)(tail - consumed);
+		if( free == 0 ) {
+			throw SocketException("The frame buffer is full.");
+		}
+
+		int32 offset = (int32)(tail % capacity);
+		if( offset + free <= capacity ) {
+			slices[0] = IoSlice(ring + offset, free);
+			return 1;
+		}
+		slices[0] = IoSlice(ring + offset, capacity - offset);
+		slices[1] = IoSlice(ring, free - (capacity - offset));
+		return 2;
+	}
+
+	//decodes the header at parsed, returns its length or 0 when it is not complete yet
+	int32 Header(int32& size)
+	{
+		int32 available = (int32)(tail - parsed);
+		switch( header ) {
+			case FrameHeader::UInt16:
+				if( available < 2 )
+					return 0;
+				size = (At(parsed) << 8) | At(parsed + 1);
+				return 2;
+			case FrameHeader::UInt32:
+				if( available < 4 )
+					return 0;
+				if( At(parsed) & 0x80 ) {
+					throw SocketException("The frame exceeds the maximum size.");
+				}
+				size = (At(parsed) << 24) | (At(parsed + 1) << 16) | (At(parsed + 2) << 8) | At(parsed + 3);
+				return 4;
+			default:
+				size = 0;
+				for( int32 i = 0; i < MaxHeaderSize; i++ ) {
+					if( i == available )
+						return 0;
+					uint8 byte = At(parsed + i);
+					if( i == MaxHeaderSize - 1 && (byte & 0xf8) != 0 ) {
+						throw SocketException("The frame exceeds the maximum size.");
+					}
+					size |= (int32)(byte & 0x7f) << (7 * i);
+					if( (byte & 0x80) == 0 )
+						return i + 1;
+				}
+				return 0;
+		}
+	}
+};
+
+FrameReader::FrameReader( Socket& socket, FrameHeader::Enum header, int32 capacity, int32 maxFrame )
+{
+	if( maxFrame < 0 || capacity < maxFrame + MaxHeaderSize ) {
+		throw SocketException("Argument capacity or maxFrame is out of range.");
+	}
+
+	m_impl = new Impl(socket);
+	m_impl->header = header;
+	m_impl->ring = new uint8[capacity];
+	m_impl->capacity = capacity;
+	m_impl->maxFrame = maxFrame;
+	m_impl->consumed = 0;
+	m_impl->parsed = 0;
+	m_impl->tail = 0;
+	m_impl->filling = false;
+}
+
+FrameReader::~FrameReader()
+{
+	delete[] m_impl->ring;
+	delete m_impl;
+}
+
+int32 FrameReader::WriteHeader( FrameHeader::Enum header, int32 size, uint8* buffer )
+{
+	if( size < 0 || (header == FrameHeader::UInt16 && size > 0xffff) ) {
+		throw SocketException("Argument size is out of range.");
+	}
+
+	switch( header ) {
+		case FrameHeader::UInt16:
+			buffer[0] = (uint8)(size >> 8);
+			buffer[1] = (uint8)size;
+			return 2;
+		case FrameHeader::UInt32:
+			buffer[0] = (uint8)(size >> 24);
+			buffer[1] = (uint8)(size >> 16);
+			buffer[2] = (uint8)(size >> 8);
+			buffer[3] = (uint8)size;
+			return 4;
+		default: {
+			int32 length = 0;
+			uint32 value = (uint32)size;
+			while( value >= 0x80 ) {
+				buffer[length++] = (uint8)(value | 0x80);
+				value >>= 7;
+			}
+			buffer[length++] = (uint8)value;
+			return length;
+		}
+	}
+}
+
+bool FrameReader::Read( Frame& frame )
+{
+	for( ;; ) {
+		if( Next(frame) == true )
+			return true;
+		if( Fill() == 0 ) {
+			if( Buffered() > 0 ) {
+				throw SocketException("The stream ended in the middle of a frame.");
+			}
+			return false;
+		}
+	}
+}
+
+bool FrameReader::Next( Frame& frame )
+{
+	//the previous frame is released, an empty ring starts over unless a fill still writes to it
+	m_impl->consumed = m_impl->parsed;
+	if( m_impl->filling == false && m_impl->consumed == m_impl->tail ) {
+		m_impl->consumed = m_impl->parsed = m_impl->tail = 0;
+	}
+
+	int32 size = 0;
+	int32 length = m_impl->Header(size);
+	if( length == 0 )
+		return false;
+	if( size > m_impl->maxFrame ) {
+		throw SocketException("The frame exceeds the maximum size.");
+	}
+	if( m_impl->tail - m_impl->parsed < (uint64)(length + size) )
+		return false;
+
+	uint64 start = m_impl->parsed + length;
+	int32 offset = (int32)(start % m_impl->capacity);
+	if( offset + size <= m_impl->capacity ) {
+		frame.buffer = m_impl->ring + offset;
+	} else {
+		int32 first = m_impl->capacity - offset;
+		m_impl->scratch.resize(m_impl->maxFrame);
+		memcpy(&m_impl->scratch[0], m_impl->ring + offset, first);
+		memcpy(&m_impl->scratch[first], m_impl->ring, size - first);
+		frame.buffer = &m_impl->scratch[0];
+	}
+	frame.size = size;
+	m_impl->parsed = start + size;
+	return true;
+}
+
+int  FrameReader::Fill()
+{
+	IoSlice slices[2];
+	int32 count = m_impl->Free(slices);
+	int length = m_impl->socket.Receive(slices, count);
+	m_impl->tail += length;
+	return length;
+}
+
+IAsyncResult* FrameReader::BeginFill( AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	IoSlice slices[2];
+	int32 count = m_impl->Free(slices);
+	m_impl->filling = true;
+	try {
+		return m_impl->socket.BeginReceive(slices, count, callback, state, manager);
+	} catch( SocketException& ) {
+		m_impl->filling = false;
+		throw;
+	}
+}
+
+int  FrameReader::EndFill( IAsyncResult* result )
+{
+	int length = 0;
+	try {
+		length = m_impl->socket.EndReceive(result);
+	} catch( SocketException& ) {
+		m_impl->filling = false;
+		throw;
+	}
+	m_impl->tail += length;
+	m_impl->filling = false;
+	return length;
+}
+
+int32 FrameReader::Buffered()
+{
+	return (int32)(m_impl->tail - m_impl->parsed);
+}
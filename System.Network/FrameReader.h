@@ -0,0 +1,65 @@
+#pragma once
+#include "Network.h"
+
+namespace FrameHeader
+{
+	enum Enum
+	{
+		//big endian length
+		UInt16,
+		UInt32,
+		//little endian base 128, seven bits per byte with the high bit set on all but the last
+		Varint
+	};
+}
+
+//a received frame, buffer points into the reader and stays valid until the next call to Next or Read
+struct Frame
+{
+	uint8*	buffer;
+	int32	size;
+	Frame() : buffer(0x0), size(0) { }
+};
+
+/*
+	Splits a stream into length prefixed frames. Data is received straight
+	into a ring buffer, filling both halves of its free space with a single
+	scatter receive, and frames are handed out as views into the ring. Only
+	a frame that wraps around the end of the ring is copied, into a scratch
+	buffer of maxFrame bytes. Whenever the ring runs empty it starts over at
+	the beginning so that wrapping stays rare.
+
+	Either Read blocks until a whole frame arrived, or the caller drives the
+	socket itself with Fill or BeginFill/EndFill and takes the frames that
+	are complete with Next. At most one fill may be outstanding.
+*/
+struct FrameReader
+{
+	struct Impl;
+	Impl* m_impl;
+
+	//longest header WriteHeader produces
+	static const int32 MaxHeaderSize = 5;
+
+	//capacity must hold the largest frame including its header, the socket must outlive the reader
+	FrameReader( Socket& socket, FrameHeader::Enum header, int32 capacity, int32 maxFrame );
+	~FrameReader();
+
+	//writes the header of a frame of size bytes, returns its length
+	static int32 WriteHeader( FrameHeader::Enum header, int32 size, uint8* buffer );
+
+	//blocks until a frame is complete, returns false once the peer closed the stream between frames
+	bool Read( Frame& frame );
+	//takes the next complete frame without receiving, returns false when none is buffered
+	bool Next( Frame& frame );
+	//receives once into the free space, returns the number of bytes or 0 at the end of the stream
+	int  Fill();
+	IAsyncResult* BeginFill( AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	int  EndFill( IAsyncResult* result );
+	//bytes received and not yet handed out as a frame
+	int32 Buffered();
+
+private:
+	FrameReader(const FrameReader&);
+	FrameReader& operator=(const FrameReader&);
+};
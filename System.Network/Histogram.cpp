@@ -0,0 +1,121 @@
+#include "Histogram.h"
+
+#if PLATFORM == PLATFORM_WIN32
+#include <intrin.h>
+#endif
+
+namespace
+{
+	//index of the highest set bit, value must not be 0
+	int HighestBit(uint64 value)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return (int)index;
+		#else
+		return 63 - __builtin_clzll(value);
+		#endif
+	}
+
+	int BucketOf(uint64 value)
+	{
+		if( value < Histogram::SubBuckets )
+			return (int)value;
+		int shift = HighestBit(value) - Histogram::SubBucketBits + 1;
+		int sub = (int)(value >> shift);
+		return Histogram::SubBuckets + (shift - 1) * (Histogram::SubBuckets / 2) + (sub - Histogram::SubBuckets / 2);
+	}
+
+	//largest value counted by the bucket
+	uint64 UpperOf(int bucket)
+	{
+		if( bucket < Histogram::SubBuckets )
+			return (uint64)bucket;
+		int shift = (bucket - Histogram::SubBuckets) / (Histogram::SubBuckets / 2) + 1;
+		uint64 sub = (bucket - Histogram::SubBuckets) % (Histogram::SubBuckets / 2) + Histogram::SubBuckets / 2;
+		return ((sub + 1) << shift) - 1;
+	}
+}
+
+Histogram::Histogram() : counts(Buckets, 0), count(0), total(0), min((uint64)-1), max(0)
+{
+}
+
+void Histogram::Record(uint64 value)
+{
+	counts[BucketOf(value)]++;
+	count++;
+	total += value;
+	if( value < min )
+		min = value;
+	if( value > max )
+		max = value;
+}
+
+void Histogram::Add(const Histogram& other)
+{
+	for( int i = 0; i < Buckets; i++ )
+		counts[i] += other.counts[i];
+	count += other.count;
+	total += other.total;
+	if( other.min < min )
+		min = other.min;
+	if( other.max > max )
+		max = other.max;
+}
+
+void Histogram::Reset()
+{
+	for( int i = 0; i < Buckets; i++ )
+		counts[i] = 0;
+	count = 0;
+	total = 0;
+	min = (uint64)-1;
+	max = 0;
+}
+
+uint64 Histogram::Count() const
+{
+	return count;
+}
+
+uint64 Histogram::Min() const
+{
+	return count == 0 ? 0 : min;
+}
+
+uint64 Histogram::Max() const
+{
+	return max;
+}
+
+double Histogram::Mean() const
+{
+	return count == 0 ? 0.0 : (double)total / count;
+}
+
+uint64 Histogram::Percentile(double percentile) const
+{
+	if( count == 0 )
+		return 0;
+
+	//the rank of the value, rounded up so that the 100th percentile is the maximum
+	uint64 rank = (uint64)(percentile / 100.0 * count);
+	if( rank < percentile / 100.0 * count )
+		rank++;
+	if( rank < 1 )
+		rank = 1;
+	if( rank > count )
+		rank = count;
+
+	uint64 seen = 0;
+	for( int i = 0; i < Buckets; i++ ) {
+		seen += counts[i];
+		if( seen >= rank ) {
+			uint64 upper = UpperOf(i);
+			return upper < max ? upper : max;
+		}
+	}
+	return max;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Config.h"
+#include <vector>
+
+/*
+	Histogram of latencies in the manner of HdrHistogram. Values below
+	SubBuckets are counted exactly, above that every power of two is split
+	into SubBuckets / 2 buckets, so a value is reported within 1/128 of
+	itself over the whole 64 bit range. Recording is an index computation
+	and an increment, percentiles walk the buckets. The histogram does no
+	locking, per thread histograms are combined with Add.
+*/
+struct Histogram
+{
+	enum
+	{
+		SubBucketBits = 8,
+		SubBuckets = 1 << SubBucketBits,
+		Buckets = SubBuckets + (64 - SubBucketBits) * (SubBuckets / 2)
+	};
+
+	Histogram();
+
+	void   Record(uint64 value);
+	void   Add(const Histogram& other);
+	void   Reset();
+	uint64 Count() const;
+	uint64 Min() const;
+	uint64 Max() const;
+	double Mean() const;
+	//the value percentile percent of the recorded values do not exceed, 0 when nothing was recorded
+	uint64 Percentile(double percentile) const;
+
+private:
+	std::vector<uint64> counts;
+	uint64	count;
+	uint64	total;
+	uint64	min;
+	uint64	max;
+};
@@ -0,0 +1,329 @@
+#include "NetworkImpl.h"
+#include "IOStatistics.h"
+#include "Threading.h"
+#include <vector>
+
+#if PLATFORM == PLATFORM_LINUX
+#include <netinet/tcp.h>
+#endif
+
+namespace
+{
+	struct Shard
+	{
+		uint64		counters[IOCounter::Count];
+		//latencies are recorded far less often than transfers, the lock lets snapshots copy them
+		Mutex		mutex;
+		//allocated on the first accept or connect of the thread
+		Histogram*	acceptLatency;
+		Histogram*	connectLatency;
+
+		Shard() : acceptLatency(0x0), connectLatency(0x0)
+		{
+			for( int i = 0; i < IOCounter::Count; i++ )
+				counters[i] = 0;
+		}
+	};
+
+	//counters have a single writer, a relaxed load and store is enough for snapshots to see whole values
+	inline void Add(uint64& counter, uint64 value)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		InterlockedExchangeAdd64((volatile LONGLONG*)&counter, value);
+		#else
+		__atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+		#endif
+	}
+
+	inline uint64 Load(uint64& counter)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		return InterlockedCompareExchange64((volatile LONGLONG*)&counter, 0, 0);
+		#else
+		return __atomic_load_n(&counter, __ATOMIC_RELAXED);
+		#endif
+	}
+
+	inline int64 Increment(int64& value, int64 amount)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		return InterlockedExchangeAdd64((volatile LONGLONG*)&value, amount) + amount;
+		#else
+		return __atomic_add_fetch(&value, amount, __ATOMIC_RELAXED);
+		#endif
+	}
+
+	//socket counters may be written by the thread of the socket and by a manager at once
+	inline void Sum(uint64& counter, uint64 value)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		InterlockedExchangeAdd64((volatile LONGLONG*)&counter, value);
+		#else
+		__atomic_fetch_add(&counter, value, __ATOMIC_RELAXED);
+		#endif
+	}
+
+	#if PLATFORM == PLATFORM_WIN32
+	void WINAPI Retire(void* shard);
+	#else
+	void Retire(void* shard);
+	#endif
+
+	struct Registry
+	{
+		Mutex	mutex;
+		std::vector<Shard*> shards;
+		//shards of threads that exited
+		std::vector<Shard*> spare;
+		int64	live;
+		int64	peak;
+		//hands the shard back once its thread exits
+		#if PLATFORM == PLATFORM_WIN32
+		DWORD	key;
+		#else
+		pthread_key_t key;
+		#endif
+
+		Registry() : live(0), peak(0)
+		{
+			#if PLATFORM == PLATFORM_WIN32
+			key = FlsAlloc(&Retire);
+			#else
+			pthread_key_create(&key, &Retire);
+			#endif
+		}
+	};
+
+	//never destroyed, threads may still count while the process exits
+	Registry* registry = new Registry();
+	THREAD_LOCAL Shard* local = 0x0;
+
+	#if PLATFORM == PLATFORM_WIN32
+	void WINAPI Retire(void* shard)
+	#else
+	void Retire(void* shard)
+	#endif
+	{
+		if( shard == 0x0 )
+			return;
+		local = 0x0;
+		ScopedLock lock(registry->mutex);
+		registry->spare.push_back(reinterpret_cast<Shard*>(shard));
+	}
+
+	Shard* Attach()
+	{
+		Shard* shard = 0x0;
+		{
+			ScopedLock lock(registry->mutex);
+			if( registry->spare.empty() == false ) {
+				shard = registry->spare.back();
+				registry->spare.pop_back();
+			} else {
+				shard = new Shard();
+				registry->shards.push_back(shard);
+			}
+		}
+		#if PLATFORM == PLATFORM_WIN32
+		FlsSetValue(registry->key, shard);
+		#else
+		pthread_setspecific(registry->key, shard);
+		#endif
+		local = shard;
+		return shard;
+	}
+
+	inline Shard* Local()
+	{
+		Shard* shard = local;
+		return shard != 0x0 ? shard : Attach();
+	}
+
+	inline bool WouldBlock(int errorCode)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		return errorCode == WSAEWOULDBLOCK;
+		#else
+		return errorCode == EAGAIN || errorCode == EWOULDBLOCK;
+		#endif
+	}
+}
+
+struct SocketCounters
+{
+	uint64	counters[IOCounter::Count];
+	SocketCounters()
+	{
+		for( int i = 0; i < IOCounter::Count; i++ )
+			counters[i] = 0;
+	}
+};
+
+void countSend(SocketCounters* counters, int64 length, int64 size, int errorCode)
+{
+	Shard* shard = Local();
+	Add(shard->counters[IOCounter::Sends], 1);
+	if( counters != 0x0 )
+		Sum(counters->counters[IOCounter::Sends], 1);
+	if( length == SOCKET_ERROR ) {
+		if( WouldBlock(errorCode) == true ) {
+			Add(shard->counters[IOCounter::WouldBlocks], 1);
+			if( counters != 0x0 )
+				Sum(counters->counters[IOCounter::WouldBlocks], 1);
+		}
+		return;
+	}
+	Add(shard->counters[IOCounter::SentBytes], length);
+	if( counters != 0x0 )
+		Sum(counters->counters[IOCounter::SentBytes], length);
+	if( length < size ) {
+		Add(shard->counters[IOCounter::PartialSends], 1);
+		if( counters != 0x0 )
+			Sum(counters->counters[IOCounter::PartialSends], 1);
+	}
+}
+
+void countReceive(SocketCounters* counters, int64 length, int errorCode)
+{
+	Shard* shard = Local();
+	Add(shard->counters[IOCounter::Receives], 1);
+	if( counters != 0x0 )
+		Sum(counters->counters[IOCounter::Receives], 1);
+	if( length == SOCKET_ERROR ) {
+		if( WouldBlock(errorCode) == true ) {
+			Add(shard->counters[IOCounter::WouldBlocks], 1);
+			if( counters != 0x0 )
+				Sum(counters->counters[IOCounter::WouldBlocks], 1);
+		}
+		return;
+	}
+	Add(shard->counters[IOCounter::ReceivedBytes], length);
+	if( counters != 0x0 )
+		Sum(counters->counters[IOCounter::ReceivedBytes], length);
+}
+
+void countEstablished(SocketOperation::Enum operation, int count, uint64 started)
+{
+	Shard* shard = Local();
+	bool accept = operation == SocketOperation::Accept;
+	Add(shard->counters[accept == true ? IOCounter::Accepts : IOCounter::Connects], count);
+	if( started == 0 )
+		return;
+
+	uint64 latency = Nanoseconds() - started;
+	ScopedLock lock(shard->mutex);
+	Histogram*& histogram = accept == true ? shard->acceptLatency : shard->connectLatency;
+	if( histogram == 0x0 )
+		histogram = new Histogram();
+	histogram->Record(latency);
+}
+
+void countOpened(Socket::Impl* impl)
+{
+	if( impl->counted == 1 )
+		return;
+	impl->counted = 1;
+
+	int64 live = Increment(registry->live, 1);
+	#if PLATFORM == PLATFORM_WIN32
+	int64 peak = InterlockedCompareExchange64((volatile LONGLONG*)&registry->peak, 0, 0);
+	while( live > peak ) {
+		int64 seen = InterlockedCompareExchange64((volatile LONGLONG*)&registry->peak, live, peak);
+		if( seen == peak )
+			break;
+		peak = seen;
+	}
+	#else
+	int64 peak = __atomic_load_n(&registry->peak, __ATOMIC_RELAXED);
+	while( live > peak && __atomic_compare_exchange_n(&registry->peak, &peak, live, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED) == false )
+		;
+	#endif
+}
+
+void countClosed(Socket::Impl* impl)
+{
+	if( impl->counted == 0 )
+		return;
+	impl->counted = 0;
+	Increment(registry->live, -1);
+}
+
+void releaseCounters(Socket::Impl* impl)
+{
+	delete impl->counters;
+	impl->counters = 0x0;
+}
+
+IOStatistics::Snapshot::Snapshot() : liveConnections(0), peakConnections(0)
+{
+	for( int i = 0; i < IOCounter::Count; i++ )
+		counters[i] = 0;
+}
+
+void IOStatistics::Take(Snapshot& snapshot)
+{
+	for( int i = 0; i < IOCounter::Count; i++ )
+		snapshot.counters[i] = 0;
+	snapshot.acceptLatency.Reset();
+	snapshot.connectLatency.Reset();
+
+	ScopedLock lock(registry->mutex);
+	for( size_t i = 0; i < registry->shards.size(); i++ ) {
+		Shard* shard = registry->shards[i];
+		for( int j = 0; j < IOCounter::Count; j++ )
+			snapshot.counters[j] += Load(shard->counters[j]);
+
+		ScopedLock shardLock(shard->mutex);
+		if( shard->acceptLatency != 0x0 )
+			snapshot.acceptLatency.Add(*shard->acceptLatency);
+		if( shard->connectLatency != 0x0 )
+			snapshot.connectLatency.Add(*shard->connectLatency);
+	}
+	snapshot.liveConnections = Increment(registry->live, 0);
+	snapshot.peakConnections = Increment(registry->peak, 0);
+}
+
+IOStatistics::SocketSnapshot::SocketSnapshot()
+{
+	for( int i = 0; i < IOCounter::Count; i++ )
+		counters[i] = 0;
+}
+
+void IOStatistics::Track(Socket& socket)
+{
+	Socket::Impl* impl = reinterpret_cast<Socket::Impl*>(&socket.m_impl);
+	if( impl->socket == INVALID_SOCKET ) {
+		throw SocketException("The socket is not valid.");
+	}
+	if( impl->counters == 0x0 )
+		impl->counters = new SocketCounters();
+}
+
+bool IOStatistics::Take(Socket& socket, SocketSnapshot& snapshot)
+{
+	SocketCounters* counters = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->counters;
+	if( counters == 0x0 )
+		return false;
+	for( int i = 0; i < IOCounter::Count; i++ )
+		snapshot.counters[i] = Load(counters->counters[i]);
+	return true;
+}
+
+bool IOStatistics::Sample(Socket& socket, TcpSample& sample)
+{
+	#if PLATFORM == PLATFORM_LINUX
+	tcp_info info;
+	socklen_t length = sizeof(info);
+	if( getsockopt(reinterpret_cast<Socket::Impl*>(&socket.m_impl)->socket, IPPROTO_TCP, TCP_INFO, &info, &length) != 0 )
+		return false;
+	sample.rtt = info.tcpi_rtt;
+	sample.rttVariance = info.tcpi_rttvar;
+	sample.retransmits = info.tcpi_total_retrans;
+	sample.lost = info.tcpi_lost;
+	sample.congestionWindow = info.tcpi_snd_cwnd;
+	sample.unacknowledged = info.tcpi_unacked;
+	return true;
+	#else
+	return false;
+	#endif
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "Network.h"
+#include "Histogram.h"
+
+namespace IOCounter
+{
+	enum Enum
+	{
+		//send and receive calls made by Socket and the managers, and the bytes they transferred
+		Sends,
+		SentBytes,
+		Receives,
+		ReceivedBytes,
+		//calls that found the socket not ready
+		WouldBlocks,
+		//sends that transferred less than they were given
+		PartialSends,
+		Accepts,
+		Connects,
+		Count
+	};
+}
+
+//kernel view of a TCP connection
+struct TcpSample
+{
+	//smoothed round trip time and its variance in microseconds
+	uint32	rtt;
+	uint32	rttVariance;
+	//segments retransmitted over the lifetime of the connection, and those currently considered lost
+	uint32	retransmits;
+	uint32	lost;
+	//congestion window and segments not yet acknowledged
+	uint32	congestionWindow;
+	uint32	unacknowledged;
+	TcpSample() : rtt(0), rttVariance(0), retransmits(0), lost(0), congestionWindow(0), unacknowledged(0) { }
+};
+
+/*
+	Process wide I/O counters. Every thread counts into a shard of its own
+	without locking, a snapshot sums up the shards; counts of a thread that
+	exited stay in its shard, which the next thread reuses. Counters only
+	grow, the difference of two snapshots gives the rates in between.
+	Connections are live from the accept or connect until the Socket is
+	closed. A tracked socket also counts its own sends and receives, from
+	Socket and from the managers, until it is closed; Accepts and Connects
+	are only counted process wide.
+*/
+struct IOStatistics
+{
+	struct Snapshot
+	{
+		uint64	counters[IOCounter::Count];
+		int64	liveConnections;
+		int64	peakConnections;
+		//nanoseconds from the start of an accept or connect call, or its Begin, until it completed
+		Histogram acceptLatency;
+		Histogram connectLatency;
+		Snapshot();
+	};
+
+	//updates of other threads that are in flight may or may not be included
+	static void Take(Snapshot& snapshot);
+	struct SocketSnapshot
+	{
+		uint64	counters[IOCounter::Count];
+		SocketSnapshot();
+	};
+
+	//starts counting the transfers of the socket, a manager already servicing it counts from its
+	//next operation on; tracking stays with the descriptor when the Socket is moved and ends when
+	//it is closed
+	static void Track(Socket& socket);
+	//false when the socket is not tracked
+	static bool Take(Socket& socket, SocketSnapshot& snapshot);
+	//reads TCP_INFO of the connection, false when the platform does not provide it
+	static bool Sample(Socket& socket, TcpSample& sample);
+};
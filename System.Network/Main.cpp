@@ -1,28 +1,114 @@
-#include "Network.h"
+#include "Benchmark.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
-void main()
+namespace
 {
-	try
+	void Usage()
 	{
-		TcpListener l(IPAdress::Loopback, 3200);
-		l.Start();
-
-		Socket s(AdressFamilly::InterNetwork, SocketType::Stream, ProtocolType::Tcp);
-		s.Connect(IPAdress::Loopback, 3200);
+		printf("usage: System.Network [scenario] [mode] [options]\r\n");
+		printf("  scenario  all, throughput, pingpong, connect or scale\r\n");
+		printf("  mode      all, blocking, poll, epoll, uring or runtime\r\n");
+		printf("  -d ms     duration of each timed scenario\r\n");
+		printf("  -c n      client threads\r\n");
+		printf("  -b bytes  send size of throughput\r\n");
+		printf("  -m bytes  message size of pingpong and scale\r\n");
+		printf("  -n n      connections scale opens\r\n");
+		printf("  -a n      connections scale exchanges messages over\r\n");
+		printf("  -l n      event loops of the runtime mode, one per core by default\r\n");
+		printf("  -p port   port of the server\r\n");
+	}
 
-		while( true )
-		{
-			Socket s;
-			if( l.Pending() == true ) {
-				s = l.Accept();
-				
-				IPEndPoint rpoint, lpoint;
-				printf("accepted %s - %s\r\n", s.LocalEndPoint(lpoint)->ToString().c_str(),  s.RemoteEndPoint(rpoint)->ToString().c_str() );
+	void Run(const char* scenario, const Benchmark::Options& options)
+	{
+		bool all = strcmp(scenario, "all") == 0;
+		try {
+			if( all == true || strcmp(scenario, "throughput") == 0 ) {
+				Benchmark::Report report;
+				Benchmark::Throughput(options, report);
+				report.Print();
+			}
+			if( all == true || strcmp(scenario, "pingpong") == 0 ) {
+				Benchmark::Report report;
+				Benchmark::PingPong(options, report);
+				report.Print();
+			}
+			if( all == true || strcmp(scenario, "connect") == 0 ) {
+				Benchmark::Report report;
+				Benchmark::ConnectRate(options, report);
+				report.Print();
 			}
+			if( all == true || strcmp(scenario, "scale") == 0 ) {
+				Benchmark::Report setup, active;
+				Benchmark::Scale(options, setup, active);
+				setup.Print();
+				active.Print();
+			}
+		} catch( SocketException& exception ) {
+			printf("%s failed: %s\r\n", Benchmark::Name(options.mode), exception.what());
 		}
 	}
-	catch( SocketException& s )
-	{
-		printf("error occured: %s\r\n", s.what());
+}
+
+int main(int argc, char** argv)
+{
+	const char* scenario = "all";
+	const char* mode = "all";
+	Benchmark::Options options;
+
+	int positional = 0;
+	for( int i = 1; i < argc; i++ ) {
+		if( argv[i][0] != '-' ) {
+			if( positional++ == 0 )
+				scenario = argv[i];
+			else
+				mode = argv[i];
+			continue;
+		}
+		if( i + 1 >= argc ) {
+			Usage();
+			return 1;
+		}
+		int value = atoi(argv[++i]);
+		switch( argv[i - 1][1] ) {
+			case 'd': options.duration = value; break;
+			case 'c': options.clients = value; break;
+			case 'b': options.chunkSize = value; break;
+			case 'm': options.messageSize = value; break;
+			case 'n': options.connections = value; break;
+			case 'a': options.active = value; break;
+			case 'l': options.loops = value; break;
+			case 'p': options.port = value; break;
+			default:
+				Usage();
+				return 1;
+		}
+	}
+
+	const char* scenarios[] = { "all", "throughput", "pingpong", "connect", "scale" };
+	bool known = false;
+	for( int i = 0; i < 5; i++ )
+		known = known || strcmp(scenario, scenarios[i]) == 0;
+	if( known == false ) {
+		Usage();
+		return 1;
+	}
+
+	const BenchmarkMode::Enum modes[] = { BenchmarkMode::Blocking, BenchmarkMode::Poll, BenchmarkMode::Epoll, BenchmarkMode::Uring, BenchmarkMode::Runtime };
+	bool ran = false;
+	for( int i = 0; i < 5; i++ ) {
+		if( strcmp(mode, "all") != 0 && strcmp(mode, Benchmark::Name(modes[i])) != 0 )
+			continue;
+		if( Benchmark::Available(modes[i]) == false )
+			continue;
+		options.mode = modes[i];
+		Run(scenario, options);
+		ran = true;
+	}
+	if( ran == false ) {
+		Usage();
+		return 1;
 	}
-}
\ No newline at end of file
+	return 0;
+}
@@ -1,78 +1,239 @@
-#include "Network.h"
+#include "NetworkImpl.h"
+#include "EpollIOManager.h"
+#include "DnsResolver.h"
+#include "Threading.h"
+#include <string>
+#include <vector>
 
-#if PLATFORM == PLATFORM_WIN32
-#ifdef _WIN32_WINNT
-#undef _WIN32_WINNT
-#define _WIN32_WINNT 0x0600
-#endif
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
-#elif PLATFORM == PLATFORM_LINUX 
-#include <errno.h>
-#include <sys/ioctl.h>
-#include <sys/time.h>
-#include <unistd.h>
-#include <ctime>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <netdb.h>
-#include <arpa/inet.h>
-#endif 
 
+const char* resolveError(int errorCode)
+{
+	#if PLATFORM == PLATFORM_WIN32
+	switch(errorCode)
+	{
+		case WSANOTINITIALISED:
+			return "A successful WSAStartup call must occur before using this function.";
+		case WSAENETDOWN:
+			return "The network subsystem has failed.";
+		case WSAEADDRINUSE:
+			return "Only one usage of each socket address (protocol/network address/port) is normally permitted.";
+		case WSAEINTR:
+			return "The blocking Windows Socket 1.1 call was canceled through WSACancelBlockingCall.";
+		case WSAEINPROGRESS:
+			return "A blocking Windows Sockets 1.1 call is in progress, or the service provider is still processing a callback function.";
+		case WSAEALREADY:
+			return "A nonblocking connect call is in progress on the specified socket.";
+		case WSAEADDRNOTAVAIL:
+			return "The remote address is not a valid address (such as INADDR_ANY or in6addr_any)";
+		case WSAEAFNOSUPPORT:
+			return "Addresses in the specified family cannot be used with this socket.";
+		case WSAECONNREFUSED:
+			return "The attempt to connect was forcefully rejected.";
+		case WSAEFAULT:
+			return "The sockaddr structure pointed to by the name contains incorrect address format for the associated address family or the namelen parameter is too small. This error is also returned if the sockaddr structure pointed to by the name parameter with a length specified in the namelen parameter is not in a valid part of the user address space.";
+		case WSAEINVAL:
+			return "The parameter s is a listening socket.";
+		case WSAEISCONN:
+			return "The socket is already connected (connection-oriented sockets only).";
+		case WSAENETUNREACH:
+			return "The network cannot be reached from this host at this time.";
+		case WSAEHOSTUNREACH:
+			return "A socket operation was attempted to an unreachable host.";
+		case WSAENOBUFS:
+			return "No buffer space is available. The socket cannot be connected.";
+		case WSAENOTSOCK:
+			return "The descriptor specified in the s parameter is not a socket.";
+		case WSAETIMEDOUT:
+			return "An attempt to connect timed out without establishing a connection.";
+		case WSAEWOULDBLOCK:
+			return "The socket is marked as nonblocking and the connection cannot be completed immediately.";
+		case WSAEACCES:
+			return "An attempt to connect a datagram socket to broadcast address failed because setsockopt option SO_BROADCAST is not enabled.";
+		case WSAECONNRESET:
+			return "An existing connection was forcibly closed by the remote host.";
+		case WSAECONNABORTED:
+			return "An established connection was aborted by the software in your host machine.";
+		case WSAENETRESET:
+			return "The connection has been broken due to keep-alive activity detecting a failure while the operation was in progress.";
+		case WSAENOTCONN:
+			return "The socket is not connected.";
+		case WSAESHUTDOWN:
+			return "The socket has been shut down in the direction of the operation.";
+		case WSAEMSGSIZE:
+			return "The message was too large to fit into the specified buffer and was truncated.";
+		case WSA_OPERATION_ABORTED:
+			return "The overlapped operation has been canceled.";
+
+	}
+	#elif PLATFORM == PLATFORM_LINUX
+	return strerror(errorCode);
+	#endif
+
+	return 0x0;
+}
+
+SocketError::Enum resolveSocketError(int errorCode)
+{
+	#if PLATFORM == PLATFORM_WIN32
+	return (SocketError::Enum)errorCode;
+	#elif PLATFORM == PLATFORM_LINUX
+	switch(errorCode)
+	{
+		case 0:				return SocketError::Success;
+		case EAGAIN:		return SocketError::WouldBlock;
+		case EINTR:			return SocketError::Interrupted;
+		case ECONNRESET:	return SocketError::ConnectionReset;
+		//a send after the peer closed
+		case EPIPE:			return SocketError::Shutdown;
+		case ESHUTDOWN:		return SocketError::Shutdown;
+		case ECONNABORTED:	return SocketError::ConnectionAborted;
+		case ECONNREFUSED:	return SocketError::ConnectionRefused;
+		case ETIMEDOUT:		return SocketError::TimedOut;
+		case ECANCELED:		return SocketError::OperationAborted;
+		case EINPROGRESS:	return SocketError::InProgress;
+		case EALREADY:		return SocketError::AlreadyInProgress;
+		case EISCONN:		return SocketError::IsConnected;
+		case ENOTCONN:		return SocketError::NotConnected;
+		case EACCES:		return SocketError::AccessDenied;
+		case EPERM:			return SocketError::AccessDenied;
+		case EFAULT:		return SocketError::Fault;
+		case EINVAL:		return SocketError::InvalidArgument;
+		case EMFILE:		return SocketError::TooManyOpenSockets;
+		case ENFILE:		return SocketError::TooManyOpenSockets;
+		case EBADF:			return SocketError::NotSocket;
+		case ENOTSOCK:		return SocketError::NotSocket;
+		case EDESTADDRREQ:	return SocketError::DestinationAddressRequired;
+		case EMSGSIZE:		return SocketError::MessageSize;
+		case EPROTOTYPE:	return SocketError::ProtocolType;
+		case ENOPROTOOPT:	return SocketError::ProtocolOption;
+		case EPROTONOSUPPORT:	return SocketError::ProtocolNotSupported;
+		case ESOCKTNOSUPPORT:	return SocketError::SocketNotSupported;
+		case EOPNOTSUPP:	return SocketError::OperationNotSupported;
+		case EPFNOSUPPORT:	return SocketError::ProtocolFamilyNotSupported;
+		case EAFNOSUPPORT:	return SocketError::AddressFamilyNotSupported;
+		case EADDRINUSE:	return SocketError::AddressAlreadyInUse;
+		case EADDRNOTAVAIL:	return SocketError::AddressNotAvailable;
+		case ENETDOWN:		return SocketError::NetworkDown;
+		case ENETUNREACH:	return SocketError::NetworkUnreachable;
+		case ENETRESET:		return SocketError::NetworkReset;
+		case ENOBUFS:		return SocketError::NoBufferSpaceAvailable;
+		case ENOMEM:		return SocketError::NoBufferSpaceAvailable;
+		case EHOSTDOWN:		return SocketError::HostDown;
+		case EHOSTUNREACH:	return SocketError::HostUnreachable;
+	}
+	#endif
+	return SocketError::SocketError;
+}
+
+const char* SocketError::Message(SocketError::Enum error)
+{
+	if( error == Success )
+		return "The operation completed successfully.";
+
+	#if PLATFORM == PLATFORM_WIN32
+	const char* description = resolveError(error);
+	#elif PLATFORM == PLATFORM_LINUX
+	//back to the errno the error is usually raised for
+	int errorCode = -1;
+	switch(error)
+	{
+		case WouldBlock:			errorCode = EAGAIN; break;
+		case Interrupted:			errorCode = EINTR; break;
+		case ConnectionReset:		errorCode = ECONNRESET; break;
+		case Shutdown:				errorCode = EPIPE; break;
+		case ConnectionAborted:		errorCode = ECONNABORTED; break;
+		case ConnectionRefused:		errorCode = ECONNREFUSED; break;
+		case TimedOut:				errorCode = ETIMEDOUT; break;
+		case OperationAborted:		errorCode = ECANCELED; break;
+		case InProgress:			errorCode = EINPROGRESS; break;
+		case AlreadyInProgress:		errorCode = EALREADY; break;
+		case IsConnected:			errorCode = EISCONN; break;
+		case NotConnected:			errorCode = ENOTCONN; break;
+		case AccessDenied:			errorCode = EACCES; break;
+		case Fault:					errorCode = EFAULT; break;
+		case InvalidArgument:		errorCode = EINVAL; break;
+		case TooManyOpenSockets:	errorCode = EMFILE; break;
+		case NotSocket:				errorCode = ENOTSOCK; break;
+		case DestinationAddressRequired:	errorCode = EDESTADDRREQ; break;
+		case MessageSize:			errorCode = EMSGSIZE; break;
+		case ProtocolType:			errorCode = EPROTOTYPE; break;
+		case ProtocolOption:		errorCode = ENOPROTOOPT; break;
+		case ProtocolNotSupported:	errorCode = EPROTONOSUPPORT; break;
+		case SocketNotSupported:	errorCode = ESOCKTNOSUPPORT; break;
+		case OperationNotSupported:	errorCode = EOPNOTSUPP; break;
+		case ProtocolFamilyNotSupported:	errorCode = EPFNOSUPPORT; break;
+		case AddressFamilyNotSupported:		errorCode = EAFNOSUPPORT; break;
+		case AddressAlreadyInUse:	errorCode = EADDRINUSE; break;
+		case AddressNotAvailable:	errorCode = EADDRNOTAVAIL; break;
+		case NetworkDown:			errorCode = ENETDOWN; break;
+		case NetworkUnreachable:	errorCode = ENETUNREACH; break;
+		case NetworkReset:			errorCode = ENETRESET; break;
+		case NoBufferSpaceAvailable:	errorCode = ENOBUFS; break;
+		case HostDown:				errorCode = EHOSTDOWN; break;
+		case HostUnreachable:		errorCode = EHOSTUNREACH; break;
+		case Success:
+		case SocketError:			break;
+	}
+	const char* description = errorCode == -1 ? 0x0 : resolveError(errorCode);
+	#endif
+	return description != 0x0 ? description : "An unspecified socket error occurred.";
+}
 
 namespace 
 {
-	const char* resolveError(int errorCode)
+	//datagrams transferred per sendmmsg/recvmmsg call
+	const int DatagramBatch = 64;
+
+	int64 SizeOf(const IoSlice* slices, int32 count)
 	{
-		#if PLATFORM == PLATFORM_WIN32
-		switch(errorCode)
-		{
-			case WSANOTINITIALISED:
-				return "A successful WSAStartup call must occur before using this function.";
-			case WSAENETDOWN:
-				return "The network subsystem has failed.";
-			case WSAEADDRINUSE:
-				return "Only one usage of each socket address (protocol/network address/port) is normally permitted.";
-			case WSAEINTR:
-				return "The blocking Windows Socket 1.1 call was canceled through WSACancelBlockingCall.";
-			case WSAEINPROGRESS:
-				return "A blocking Windows Sockets 1.1 call is in progress, or the service provider is still processing a callback function.";
-			case WSAEALREADY:
-				return "A nonblocking connect call is in progress on the specified socket.";
-			case WSAEADDRNOTAVAIL:
-				return "The remote address is not a valid address (such as INADDR_ANY or in6addr_any)";
-			case WSAEAFNOSUPPORT:
-				return "Addresses in the specified family cannot be used with this socket.";
-			case WSAECONNREFUSED:
-				return "The attempt to connect was forcefully rejected.";
-			case WSAEFAULT:
-				return "The sockaddr structure pointed to by the name contains incorrect address format for the associated address family or the namelen parameter is too small. This error is also returned if the sockaddr structure pointed to by the name parameter with a length specified in the namelen parameter is not in a valid part of the user address space.";
-			case WSAEINVAL:
-				return "The parameter s is a listening socket.";
-			case WSAEISCONN:
-				return "The socket is already connected (connection-oriented sockets only).";
-			case WSAENETUNREACH:
-				return "The network cannot be reached from this host at this time.";
-			case WSAEHOSTUNREACH:
-				return "A socket operation was attempted to an unreachable host.";
-			case WSAENOBUFS:
-				return "No buffer space is available. The socket cannot be connected.";
-			case WSAENOTSOCK:
-				return "The descriptor specified in the s parameter is not a socket.";
-			case WSAETIMEDOUT:
-				return "An attempt to connect timed out without establishing a connection.";
-			case WSAEWOULDBLOCK:
-				return "The socket is marked as nonblocking and the connection cannot be completed immediately.";
-			case WSAEACCES:
-				return "An attempt to connect a datagram socket to broadcast address failed because setsockopt option SO_BROADCAST is not enabled.";
-				
-		}
-		#endif 
-		
-		return 0x0;
+		int64 size = 0;
+		for( int32 i = 0; i < count; i++ )
+			size += slices[i].size;
+		return size;
+	}
+
+	//a send to a peer that closed fails with an error instead of raising SIGPIPE
+	#if PLATFORM == PLATFORM_WIN32
+	const int SendFlags = 0;
+	#elif PLATFORM == PLATFORM_LINUX
+	const int SendFlags = MSG_NOSIGNAL;
+	#endif
+
+	sockaddr_in ToAddress(const IPEndPoint& endPoint)
+	{
+		sockaddr_in address;
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = (uint32)endPoint.adress.adress;
+		address.sin_port = htons(endPoint.port);
+		return address;
+	}
+
+	#if PLATFORM == PLATFORM_LINUX
+	//returns the length of the address, abstract names are counted exactly since trailing zeros are part of them
+	socklen_t ToAddress(const UnixEndPoint& endPoint, sockaddr_un& address)
+	{
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if( endPoint.abstract == true ) {
+			memcpy(address.sun_path + 1, endPoint.path, endPoint.length);
+			return (socklen_t)(offsetof(sockaddr_un, sun_path) + 1 + endPoint.length);
+		}
+		memcpy(address.sun_path, endPoint.path, endPoint.length);
+		return (socklen_t)(offsetof(sockaddr_un, sun_path) + endPoint.length + 1);
+	}
+
+	//unnamed sockets, e.g. the connecting side, come back with an empty path
+	UnixEndPoint FromAddress(const sockaddr_un& address, socklen_t length)
+	{
+		int32 size = (int32)length - (int32)offsetof(sockaddr_un, sun_path);
+		if( size <= 0 )
+			return UnixEndPoint();
+		if( address.sun_path[0] == 0 )
+			return UnixEndPoint(address.sun_path + 1, size - 1, true);
+		return UnixEndPoint(address.sun_path, (int32)strnlen(address.sun_path, size), false);
 	}
+	#endif
 
 	#if PLATFORM == PLATFORM_WIN32
 	struct NetworkScope
@@ -92,18 +253,17 @@ namespace
 	#endif 
 }
 
-struct Socket::Impl
-{
-	SOCKET socket;	
-	int adressFamilly : 24;
-	int blocking	  :  8;
-};
-
 struct TcpListener::Impl
 {
 	IPEndPoint	endPoint;
+	//set instead of endPoint for AF_UNIX listeners
+	UnixEndPoint local;
 	Socket		socket;	
-	TcpListener::Impl(const Socket& s, const IPEndPoint& e) : socket(s), endPoint(e) { }
+	SocketOptions accepted;
+	//the path was created by Start and is removed by Stop
+	bool		bound;
+	Impl(const IPEndPoint& e) : endPoint(e), socket(AdressFamilly::InterNetwork, SocketType::Stream, ProtocolType::Tcp), bound(false) { }
+	Impl(const UnixEndPoint& e, SocketType::Enum type) : local(e), socket(AdressFamilly::Unix, type, ProtocolType::Unspecified), bound(false) { }
 };
 
 
@@ -129,6 +289,41 @@ std::string IPAdress::ToString() const
 	return str;
 }
 
+namespace
+{
+	void Assign(UnixEndPoint& endPoint, const char* name, int32 length, bool abstract)
+	{
+		if( length < 0 || length > UnixEndPoint::MaxLength ) {
+			throw SocketException("Argument path is too long.");
+		}
+		memcpy(endPoint.path, name, length);
+		endPoint.path[length] = 0;
+		endPoint.length = length;
+		endPoint.abstract = abstract;
+	}
+}
+
+UnixEndPoint::UnixEndPoint( const char* path, bool abstract/* = false*/ )
+{
+	Assign(*this, path, (int32)strlen(path), abstract);
+}
+
+UnixEndPoint::UnixEndPoint( const char* name, int32 length, bool abstract )
+{
+	Assign(*this, name, length, abstract);
+}
+
+std::string UnixEndPoint::ToString() const
+{
+	if( abstract == false )
+		return std::string(path, length);
+	//zeros inside an abstract name are shown as @ as well
+	std::string str("@");
+	for( int32 i = 0; i < length; i++ )
+		str.push_back(path[i] != 0 ? path[i] : '@');
+	return str;
+}
+
 std::string IPEndPoint::ToString() const
 {
 	sockaddr_in addr; 
@@ -145,29 +340,113 @@ std::string IPEndPoint::ToString() const
 
 
 
+SocketOptions::SocketOptions()
+	: noDelay(Unset), cork(Unset), sendBufferSize(Unset), receiveBufferSize(Unset),
+	  quickAck(Unset), busyPoll(Unset), notSentLowWatermark(Unset)
+{
+}
+
+void clearSocket(Socket::Impl* impl)
+{
+	new (impl) Socket::Impl();
+	impl->adressFamilly = AdressFamilly::Unspecified;
+	impl->blocking = 1;
+	impl->zeroCopy = 0;
+	impl->socket = INVALID_SOCKET;
+}
 
 
 Socket::Socket()
 {
 	STATIC_ASSERT(sizeof(Impl) <= sizeof(m_impl));
-	new (&m_impl) Impl();
-	reinterpret_cast<Socket::Impl*>(&m_impl)->adressFamilly = AdressFamilly::Unspecified;
-	reinterpret_cast<Socket::Impl*>(&m_impl)->socket = INVALID_SOCKET;
+	clearSocket(reinterpret_cast<Socket::Impl*>(&m_impl));
 }
 Socket::Socket(AdressFamilly::Enum familly, SocketType::Enum socketType, ProtocolType::Enum protocolType)
 {
 	STATIC_ASSERT(sizeof(Impl) <= sizeof(m_impl));
 	new (&m_impl) Impl();
 	reinterpret_cast<Socket::Impl*>(&m_impl)->adressFamilly = familly;
+	reinterpret_cast<Socket::Impl*>(&m_impl)->blocking = 1;
+	reinterpret_cast<Socket::Impl*>(&m_impl)->zeroCopy = 0;
+	#if PLATFORM == PLATFORM_WIN32
 	reinterpret_cast<Socket::Impl*>(&m_impl)->socket = socket(familly, socketType, protocolType);
+	#elif PLATFORM == PLATFORM_LINUX
+	reinterpret_cast<Socket::Impl*>(&m_impl)->socket = socket(familly, (int)socketType | SOCK_CLOEXEC, protocolType);
+	#endif
     if (reinterpret_cast<Socket::Impl*>(&m_impl)->socket == INVALID_SOCKET) {
         wprintf(L"socket function failed with error: %ld\n", WSAGetLastError());
     }
 }
 
+Socket::Socket(AdressFamilly::Enum familly, SocketType::Enum socketType, ProtocolType::Enum protocolType, bool blocking)
+{
+	STATIC_ASSERT(sizeof(Impl) <= sizeof(m_impl));
+	new (&m_impl) Impl();
+	reinterpret_cast<Socket::Impl*>(&m_impl)->adressFamilly = familly;
+	reinterpret_cast<Socket::Impl*>(&m_impl)->zeroCopy = 0;
+	#if PLATFORM == PLATFORM_WIN32
+	reinterpret_cast<Socket::Impl*>(&m_impl)->blocking = 1;
+	reinterpret_cast<Socket::Impl*>(&m_impl)->socket = socket(familly, socketType, protocolType);
+	if( reinterpret_cast<Socket::Impl*>(&m_impl)->socket != INVALID_SOCKET )
+		Blocking(blocking);
+	#elif PLATFORM == PLATFORM_LINUX
+	reinterpret_cast<Socket::Impl*>(&m_impl)->blocking = blocking == true ? 1 : 0;
+	reinterpret_cast<Socket::Impl*>(&m_impl)->socket = socket(familly, (int)socketType | SOCK_CLOEXEC | (blocking == true ? 0 : SOCK_NONBLOCK), protocolType);
+	#endif
+	if( reinterpret_cast<Socket::Impl*>(&m_impl)->socket == INVALID_SOCKET ) {
+		int errorCode = WSAGetLastError();
+		throw SocketException(resolveError(errorCode));
+	}
+}
+
 Socket::~Socket()
 {
+	Close();
+}
+
+#if HAS_MOVE_SEMANTICS
+Socket::Socket(Socket&& other) noexcept
+{
+	*reinterpret_cast<Socket::Impl*>(&m_impl) = *reinterpret_cast<Socket::Impl*>(&other.m_impl);
+	clearSocket(reinterpret_cast<Socket::Impl*>(&other.m_impl));
+}
+
+Socket& Socket::operator=(Socket&& other) noexcept
+{
+	if( this != &other ) {
+		Close();
+		*reinterpret_cast<Socket::Impl*>(&m_impl) = *reinterpret_cast<Socket::Impl*>(&other.m_impl);
+		clearSocket(reinterpret_cast<Socket::Impl*>(&other.m_impl));
+	}
+	return *this;
+}
+#else
+Socket::Socket(const Socket& other)
+{
+	*reinterpret_cast<Socket::Impl*>(&m_impl) = *reinterpret_cast<const Socket::Impl*>(&other.m_impl);
+	clearSocket(reinterpret_cast<Socket::Impl*>(&const_cast<Socket&>(other).m_impl));
+}
+
+Socket& Socket::operator=(const Socket& other)
+{
+	if( this != &other ) {
+		Close();
+		*reinterpret_cast<Socket::Impl*>(&m_impl) = *reinterpret_cast<const Socket::Impl*>(&other.m_impl);
+		clearSocket(reinterpret_cast<Socket::Impl*>(&const_cast<Socket&>(other).m_impl));
+	}
+	return *this;
+}
+#endif
+
+bool Socket::Valid()
+{
+	return reinterpret_cast<Socket::Impl*>(&m_impl)->socket != INVALID_SOCKET;
+}
 
+int64 Socket::Descriptor()
+{
+	SOCKET socket = reinterpret_cast<Socket::Impl*>(&m_impl)->socket;
+	return socket != INVALID_SOCKET ? (int64)socket : -1;
 }
 
 
@@ -175,21 +454,103 @@ Socket::~Socket()
 
 void Socket::Accept(Socket& accepted)
 {	
-	#if PLATFORM == PLATFORM_WIN32
-	u_long nonblocking = 0;
-	ioctlsocket(reinterpret_cast<Impl*>(&m_impl)->socket, FIONBIO, &nonblocking);
-	#elif PLATFORM == PLATFORM_LINUX
-	fcntl(s, F_SETFL, fcntl(reinterpret_cast<Impl*>(&m_impl)->socket, F_GETFL, 0) & ~O_NONBLOCK);
-	#endif
+	//only switches the mode when the listener was made non-blocking
+	Blocking(true);
 
 	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX	
+	uint64 started = Nanoseconds();
+	//a descriptor accepted still held is replaced
+	accepted.Close();
+	clearSocket(reinterpret_cast<Impl*>(&accepted.m_impl));
+	#if PLATFORM == PLATFORM_WIN32
 	reinterpret_cast<Impl*>(&accepted.m_impl)->socket = accept( reinterpret_cast<Impl*>(&m_impl)->socket, 0,0);
+	#else
+	reinterpret_cast<Impl*>(&accepted.m_impl)->socket = accept4( reinterpret_cast<Impl*>(&m_impl)->socket, 0, 0, SOCK_CLOEXEC);
+	#endif
 	if(reinterpret_cast<Impl*>(&accepted.m_impl)->socket == INVALID_SOCKET) {		
+		return;
 	}
+	reinterpret_cast<Impl*>(&accepted.m_impl)->adressFamilly = reinterpret_cast<Impl*>(&m_impl)->adressFamilly;
+	reinterpret_cast<Impl*>(&accepted.m_impl)->blocking = 1;
+	countEstablished(SocketOperation::Accept, 1, started);
+	countOpened(reinterpret_cast<Impl*>(&accepted.m_impl));
 	
 	#endif	
 }
 
+namespace
+{
+	//drains the backlog of the non-blocking listener, errorCode is only set when nothing was accepted
+	int AcceptPending(Socket::Impl* listener, Socket* accepted, int32 capacity, int& errorCode)
+	{
+		errorCode = 0;
+		uint64 started = Nanoseconds();
+		int count = 0;
+		while( count < capacity ) {
+			#if PLATFORM == PLATFORM_WIN32
+			SOCKET socket = accept(listener->socket, 0, 0);
+			if( socket == INVALID_SOCKET ) {
+				int error = WSAGetLastError();
+				if( error == WSAECONNRESET )
+					continue;
+				if( count == 0 )
+					errorCode = error;
+				break;
+			}
+			#elif PLATFORM == PLATFORM_LINUX
+			SOCKET socket = accept4(listener->socket, 0, 0, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if( socket == INVALID_SOCKET ) {
+				int error = errno;
+				if( error == EINTR || error == ECONNABORTED )
+					continue;
+				if( count == 0 )
+					errorCode = error;
+				break;
+			}
+			#endif
+
+			//accepted sockets inherit the non-blocking mode, a descriptor the slot still held is replaced
+			accepted[count].Close();
+			clearSocket(reinterpret_cast<Socket::Impl*>(&accepted[count].m_impl));
+			reinterpret_cast<Socket::Impl*>(&accepted[count].m_impl)->socket = socket;
+			reinterpret_cast<Socket::Impl*>(&accepted[count].m_impl)->adressFamilly = listener->adressFamilly;
+			reinterpret_cast<Socket::Impl*>(&accepted[count].m_impl)->blocking = 0;
+			countOpened(reinterpret_cast<Socket::Impl*>(&accepted[count].m_impl));
+			count++;
+		}
+		if( count > 0 )
+			countEstablished(SocketOperation::Accept, count, started);
+		return count;
+	}
+}
+
+int Socket::Accept(Socket* accepted, int32 capacity)
+{
+	//the listener stays non-blocking, the backlog is drained until it is empty
+	Blocking(false);
+
+	int errorCode = 0;
+	int count = AcceptPending(reinterpret_cast<Impl*>(&m_impl), accepted, capacity, errorCode);
+	#if PLATFORM == PLATFORM_WIN32
+	if( errorCode != 0 && errorCode != WSAEWOULDBLOCK ) {
+	#elif PLATFORM == PLATFORM_LINUX
+	if( errorCode != 0 && errorCode != EAGAIN && errorCode != EWOULDBLOCK ) {
+	#endif
+		throw SocketException(resolveError(errorCode));
+	}
+	return count;
+}
+
+int Socket::Accept(Socket* accepted, int32 capacity, SocketError::Enum& error)
+{
+	Blocking(false);
+
+	int errorCode = 0;
+	int count = AcceptPending(reinterpret_cast<Impl*>(&m_impl), accepted, capacity, errorCode);
+	error = resolveSocketError(errorCode);
+	return count;
+}
+
 void Socket::Shutdown( int shutdownKinds )
 {	
 	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX
@@ -205,6 +566,358 @@ void Socket::Disconnect( bool reuseSocket )
 	#endif
 }
 
+namespace
+{
+	//delay before the next endpoint is attempted while earlier attempts are still connecting, as in RFC 8305
+	const int ConnectStagger = 250;
+
+	#if PLATFORM == PLATFORM_WIN32
+	const int ConnectTimedOut = WSAETIMEDOUT;
+	typedef WSAPOLLFD PollDescriptor;
+	#elif PLATFORM == PLATFORM_LINUX
+	const int ConnectTimedOut = ETIMEDOUT;
+	typedef pollfd PollDescriptor;
+	#endif
+
+	int LastError()
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		return WSAGetLastError();
+		#elif PLATFORM == PLATFORM_LINUX
+		return errno;
+		#endif
+	}
+
+	int SetTimeout(SOCKET socket, int name, int timeout);
+
+	//racing replaces the descriptor of the socket, which would drop a bind or turn another kind of socket into TCP
+	void CheckRace(Socket::Impl* impl)
+	{
+		if( impl->socket == INVALID_SOCKET )
+			return;
+		int type = 0; socklen_t length = sizeof(type);
+		sockaddr_in local; socklen_t localLength = sizeof(local);
+		if( impl->adressFamilly != AdressFamilly::InterNetwork
+			|| getsockopt(impl->socket, SOL_SOCKET, SO_TYPE, (char*)&type, &length) != 0 || type != SOCK_STREAM
+			|| (getsockname(impl->socket, (sockaddr*)&local, &localLength) == 0 && local.sin_port != 0) ) {
+			throw SocketException("Only unbound TCP sockets can connect over several endpoints.");
+		}
+	}
+
+	//the winning descriptor takes over the settings Impl keeps for the replaced one, zero copy is not enabled on it
+	void Adopt(Socket::Impl* impl)
+	{
+		impl->zeroCopy = 0;
+		if( impl->receiveTimeout != 0 )
+			SetTimeout(impl->socket, SO_RCVTIMEO, impl->receiveTimeout);
+		if( impl->sendTimeout != 0 )
+			SetTimeout(impl->socket, SO_SNDTIMEO, impl->sendTimeout);
+	}
+
+	//starts a non-blocking connect on a new descriptor, returns INVALID_SOCKET when it failed right away
+	SOCKET StartConnect(const IPEndPoint& endPoint, bool& connected, int& error)
+	{
+		connected = false;
+		#if PLATFORM == PLATFORM_WIN32
+		SOCKET descriptor = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		u_long nonblocking = 1;
+		if( descriptor != INVALID_SOCKET && ioctlsocket(descriptor, FIONBIO, &nonblocking) != 0 ) {
+			error = WSAGetLastError();
+			closesocket(descriptor);
+			return INVALID_SOCKET;
+		}
+		#elif PLATFORM == PLATFORM_LINUX
+		SOCKET descriptor = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+		#endif
+		if( descriptor == INVALID_SOCKET ) {
+			error = LastError();
+			return INVALID_SOCKET;
+		}
+
+		sockaddr_in remote = ToAddress(endPoint);
+		if( connect(descriptor, (sockaddr*)&remote, sizeof(remote)) == 0 ) {
+			connected = true;
+			return descriptor;
+		}
+		error = LastError();
+		#if PLATFORM == PLATFORM_WIN32
+		if( error == WSAEWOULDBLOCK )
+		#elif PLATFORM == PLATFORM_LINUX
+		if( error == EINPROGRESS )
+		#endif
+			return descriptor;
+		closesocket(descriptor);
+		return INVALID_SOCKET;
+	}
+
+	struct ConnectRace;
+
+	namespace AttemptState
+	{
+		enum Enum
+		{
+			Idle,
+			Starting,
+			Open,
+			Closed,
+			Won
+		};
+	}
+
+	struct ConnectAttempt
+	{
+		ConnectRace*		race;
+		Socket				socket;
+		AttemptState::Enum	state;
+		ConnectAttempt() : race(0x0), state(AttemptState::Idle) { }
+	};
+
+	//IAsyncResult of a connect over several endpoints, Begin, every attempt and every timer
+	//hold a reference, the race is released once it was ended and the last reference dropped
+	struct ConnectRace : IAsyncResult
+	{
+		SocketIOManager&	manager;
+		Socket&				target;
+		AsyncCallback		callback;
+		void*				state;
+		std::vector<IPEndPoint>		endPoints;
+		std::vector<ConnectAttempt>	attempts;
+		//port of the endpoints while the host name is being resolved
+		int32				port;
+		size_t				started;
+		size_t				failed;
+		int					references;
+		//message of the last failure, empty when connected
+		std::string			error;
+		bool				done;
+		bool				completed;
+		bool				ended;
+		Mutex				mutex;
+		Condition			condition;
+
+		ConnectRace(SocketIOManager& m, Socket& t, AsyncCallback c, void* s)
+			: manager(m), target(t), callback(c), state(s), port(0), started(0), failed(0), references(0), done(false), completed(false), ended(false) { }
+
+		SocketIOManager& Manager()	{ return manager; }
+		void* AsyncState()			{ return state; }
+		bool IsCompleted()
+		{
+			ScopedLock lock(mutex);
+			return completed;
+		}
+	};
+
+	void Release(ConnectRace* race)
+	{
+		bool last = false;
+		{
+			ScopedLock lock(race->mutex);
+			last = --race->references == 0 && race->ended == true;
+		}
+		if( last == true )
+			delete race;
+	}
+
+	//decides the race once, the winning descriptor replaces the one of the target socket
+	void Settle(ConnectRace* race, ConnectAttempt* winner, const std::string& error)
+	{
+		std::vector<ConnectAttempt*> losers;
+		{
+			ScopedLock lock(race->mutex);
+			if( race->done == true )
+				return;
+			race->done = true;
+			race->error = winner != 0x0 ? std::string() : error;
+			for( size_t i = 0; i < race->started; i++ ) {
+				if( race->attempts[i].state == AttemptState::Open && &race->attempts[i] != winner ) {
+					race->attempts[i].state = AttemptState::Closed;
+					losers.push_back(&race->attempts[i]);
+				}
+			}
+			if( winner != 0x0 )
+				winner->state = AttemptState::Won;
+		}
+
+		//attempts still connecting complete with ECANCELED once closed
+		for( size_t i = 0; i < losers.size(); i++ )
+			losers[i]->socket.Close();
+		if( winner != 0x0 ) {
+			//the deadlines of the target carry over to the winning descriptor
+			Socket::Impl* target = reinterpret_cast<Socket::Impl*>(&race->target.m_impl);
+			Socket::Impl previous = *target;
+			race->target.Close();
+			*target = *reinterpret_cast<Socket::Impl*>(&winner->socket.m_impl);
+			clearSocket(reinterpret_cast<Socket::Impl*>(&winner->socket.m_impl));
+			target->receiveTimeout = previous.receiveTimeout;
+			target->sendTimeout = previous.sendTimeout;
+			target->idleTimeout = previous.idleTimeout;
+			Adopt(target);
+		}
+
+		{
+			ScopedLock lock(race->mutex);
+			race->completed = true;
+			race->condition.Broadcast();
+		}
+		if( race->callback != 0x0 )
+			race->callback(race);
+	}
+
+	void Start(ConnectRace* race);
+
+	//the attempt failed or could not be started, the next endpoint is attempted right away
+	void Fail(ConnectAttempt* attempt, const std::string& error)
+	{
+		ConnectRace* race = attempt->race;
+		bool close = false, settle = false, next = false;
+		{
+			ScopedLock lock(race->mutex);
+			if( attempt->state == AttemptState::Starting || attempt->state == AttemptState::Open ) {
+				attempt->state = AttemptState::Closed;
+				close = true;
+			}
+			race->failed++;
+			settle = race->done == false && race->failed == race->attempts.size();
+			next = race->done == false && race->started < race->attempts.size();
+		}
+
+		if( close == true )
+			attempt->socket.Close();
+		if( settle == true )
+			Settle(race, 0x0, error);
+		else if( next == true )
+			Start(race);
+	}
+
+	void OnAttempt(IAsyncResult* result)
+	{
+		ConnectAttempt* attempt = reinterpret_cast<ConnectAttempt*>(result->AsyncState());
+		ConnectRace* race = attempt->race;
+		try {
+			attempt->socket.EndConnect(result);
+			Settle(race, attempt, std::string());
+		} catch( SocketException& exception ) {
+			Fail(attempt, exception.what());
+		}
+		Release(race);
+	}
+
+	void OnStagger(IAsyncResult* result)
+	{
+		ConnectAttempt* attempt = reinterpret_cast<ConnectAttempt*>(result->AsyncState());
+		ConnectRace* race = attempt->race;
+		try {
+			race->manager.EndTimer(result);
+			//a failure may have started the next attempt already, which armed its own timer
+			bool latest = false;
+			{
+				ScopedLock lock(race->mutex);
+				latest = &race->attempts[race->started - 1] == attempt;
+			}
+			if( latest == true )
+				Start(race);
+		} catch( SocketException& ) {
+		}
+		Release(race);
+	}
+
+	void OnDeadline(IAsyncResult* result)
+	{
+		ConnectRace* race = reinterpret_cast<ConnectRace*>(result->AsyncState());
+		try {
+			race->manager.EndTimer(result);
+			Settle(race, 0x0, resolveError(ConnectTimedOut));
+		} catch( SocketException& ) {
+		}
+		Release(race);
+	}
+
+	void Start(ConnectRace* race)
+	{
+		ConnectAttempt* attempt = 0x0;
+		bool more = false;
+		{
+			ScopedLock lock(race->mutex);
+			if( race->done == true || race->started == race->attempts.size() )
+				return;
+			attempt = &race->attempts[race->started++];
+			attempt->state = AttemptState::Starting;
+			more = race->started < race->attempts.size();
+			race->references += more == true ? 2 : 1;
+		}
+
+		if( more == true ) {
+			try {
+				race->manager.BeginTimer(ConnectStagger, &OnStagger, attempt);
+			} catch( SocketException& ) {
+				Release(race);
+			}
+		}
+
+		try {
+			attempt->socket = Socket(AdressFamilly::InterNetwork, SocketType::Stream, ProtocolType::Tcp);
+			attempt->socket.BeginConnect(race->endPoints[attempt - &race->attempts[0]], &OnAttempt, attempt, race->manager);
+		} catch( SocketException& exception ) {
+			Fail(attempt, exception.what());
+			Release(race);
+			return;
+		}
+
+		//the race may have been decided while the attempt was starting
+		bool close = false;
+		{
+			ScopedLock lock(race->mutex);
+			if( attempt->state == AttemptState::Starting ) {
+				attempt->state = race->done == true ? AttemptState::Closed : AttemptState::Open;
+				close = race->done;
+			}
+		}
+		if( close == true )
+			attempt->socket.Close();
+	}
+
+	void OnResolved(IAsyncResult* result)
+	{
+		ConnectRace* race = reinterpret_cast<ConnectRace*>(result->AsyncState());
+		try {
+			std::vector<IPAdress> addresses;
+			DnsResolver::Default().EndGetHostAddresses(result, addresses);
+			{
+				ScopedLock lock(race->mutex);
+				for( size_t i = 0; i < addresses.size(); i++ )
+					race->endPoints.push_back(IPEndPoint(addresses[i], race->port));
+				race->attempts.resize(addresses.size());
+				for( size_t i = 0; i < race->attempts.size(); i++ )
+					race->attempts[i].race = race;
+			}
+			Start(race);
+		} catch( SocketException& exception ) {
+			Settle(race, 0x0, exception.what());
+		}
+		Release(race);
+	}
+
+	void End(ConnectRace* race)
+	{
+		std::string error;
+		bool last = false;
+		{
+			ScopedLock lock(race->mutex);
+			while( race->completed == false )
+				race->condition.Wait(race->mutex);
+			error = race->error;
+			race->ended = true;
+			last = race->references == 0;
+		}
+		if( last == true )
+			delete race;
+
+		if( error.empty() == false ) {
+			throw SocketException(error.c_str());
+		}
+	}
+}
+
 void Socket::Connect( const IPAdress& adress, int port)
 {
 	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX	
@@ -213,17 +926,20 @@ void Socket::Connect( const IPAdress& adress, int port)
 	remote.sin_addr.s_addr = adress.adress;
 	remote.sin_port=htons(port); //port to use
 
+	//the socket is left open on failure so that the caller decides whether to retry or close it
+	uint64 started = Nanoseconds();
 	int error = 0;
 	if( SOCKET_ERROR == (error = connect(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&remote, sizeof(remote)))) {
 		#if PLATFORM == PLATFORM_WIN32 
 		int errorCode = WSAGetLastError();
-		closesocket(reinterpret_cast<Socket::Impl*>(&m_impl)->socket);
 		throw SocketException(resolveError(errorCode));			
-		#elif
-		closesocket(reinterpret_cast<Socket::Impl*>(&m_impl)->socket);
-		throw SocketException(0);			
+		#elif PLATFORM == PLATFORM_LINUX
+		int errorCode = errno;
+		throw SocketException(resolveError(errorCode));			
 		#endif
 	}
+	countEstablished(SocketOperation::Connect, 1, started);
+	countOpened(reinterpret_cast<Socket::Impl*>(&m_impl));
 
 	#endif
 }
@@ -233,29 +949,189 @@ void Socket::Connect( const IPEndPoint& endPoint)
 	Connect(endPoint.adress, endPoint.port );
 }
 
-void Socket::Connect( const char* hostname, int port )
-{	
-	IPAdress adress(0);	
-	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX	
-	addrinfo* addr;
-	if(getaddrinfo(hostname, 0, 0, &addr) != 0) {
-		#if PLATFORM == PLATFORM_WIN32 
-		int errorCode = WSAGetLastError();
-		throw SocketException(resolveError(errorCode));		
-		#elif
-		throw SocketException(0);		
+void Socket::Connect( const IPEndPoint& endPoint, SocketError::Enum& error )
+{
+	sockaddr_in remote = ToAddress(endPoint);
+	remote.sin_family = reinterpret_cast<Socket::Impl*>(&m_impl)->adressFamilly;
+	uint64 started = Nanoseconds();
+	if( connect(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&remote, sizeof(remote)) == SOCKET_ERROR ) {
+		error = resolveSocketError(WSAGetLastError());
+		#if PLATFORM == PLATFORM_WIN32
+		//WinSock reports a pending connect as WSAEWOULDBLOCK, Linux as EINPROGRESS
+		if( error == SocketError::WouldBlock )
+			error = SocketError::InProgress;
 		#endif
+		//a pending connect is live from now on, its latency is not known
+		if( error == SocketError::InProgress )
+			countOpened(reinterpret_cast<Socket::Impl*>(&m_impl));
 		return;
 	}
-			
-	struct sockaddr_in *sa = (struct sockaddr_in *) addr->ai_addr;
-	adress.adress = sa->sin_addr.s_addr;
-	freeaddrinfo(addr);		
-	if(strcmp(hostname, "localhost") == 0)
-		adress = IPAdress::Loopback;
+	countEstablished(SocketOperation::Connect, 1, started);
+	countOpened(reinterpret_cast<Socket::Impl*>(&m_impl));
+	error = SocketError::Success;
+}
+
+void Socket::Connect( const UnixEndPoint& endPoint )
+{
+	#if PLATFORM == PLATFORM_WIN32
+	throw SocketException("Operation has not been implemented.");
+	#elif PLATFORM == PLATFORM_LINUX
+	sockaddr_un remote;
+	socklen_t length = ToAddress(endPoint, remote);
+	uint64 started = Nanoseconds();
+	if( connect(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&remote, length) == SOCKET_ERROR ) {
+		int errorCode = errno;
+		throw SocketException(resolveError(errorCode));
+	}
+	countEstablished(SocketOperation::Connect, 1, started);
+	countOpened(reinterpret_cast<Socket::Impl*>(&m_impl));
 	#endif
+}
+
+void Socket::Connect( const UnixEndPoint& endPoint, SocketError::Enum& error )
+{
+	#if PLATFORM == PLATFORM_WIN32
+	throw SocketException("Operation has not been implemented.");
+	#elif PLATFORM == PLATFORM_LINUX
+	sockaddr_un remote;
+	socklen_t length = ToAddress(endPoint, remote);
+	uint64 started = Nanoseconds();
+	//local connects complete at once, a full backlog fails with EAGAIN instead of going pending
+	if( connect(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&remote, length) == SOCKET_ERROR ) {
+		error = resolveSocketError(WSAGetLastError());
+		return;
+	}
+	countEstablished(SocketOperation::Connect, 1, started);
+	countOpened(reinterpret_cast<Socket::Impl*>(&m_impl));
+	error = SocketError::Success;
+	#endif
+}
+
+void Socket::Connect( const char* hostname, int port )
+{	
+	std::vector<IPAdress> addresses;
+	DnsResolver::Default().GetHostAddresses(hostname, addresses);
+
+	//the addresses are tried in turn on the descriptor of the socket, which keeps its bind and options;
+	//linux lets a stream socket connect again after a failed attempt
+	std::string error;
+	for( size_t i = 0; i < addresses.size(); i++ ) {
+		try {
+			Connect(addresses[i], port);
+			return;
+		} catch( SocketException& exception ) {
+			error = exception.what();
+		}
+	}
+	throw SocketException(error.empty() == true ? "The host name has no address." : error.c_str());
+}
+
+void Socket::Connect( const char* hostname, int port, int timeout )
+{
+	std::vector<IPAdress> addresses;
+	DnsResolver::Default().GetHostAddresses(hostname, addresses);
 
-	Connect(adress, port);
+	std::vector<IPEndPoint> endPoints;
+	for( size_t i = 0; i < addresses.size(); i++ )
+		endPoints.push_back(IPEndPoint(addresses[i], port));
+	Connect(&endPoints[0], (int32)endPoints.size(), timeout);
+}
+
+void Socket::Connect( const IPEndPoint* endPoints, int32 count, int timeout )
+{
+	if( count < 1 ) {
+		throw SocketException("Argument count is out of range.");
+	}
+	CheckRace(reinterpret_cast<Socket::Impl*>(&m_impl));
+
+	uint64 begun = Nanoseconds();
+	uint64 now = Milliseconds();
+	uint64 deadline = now + (timeout < 0 ? 0 : timeout);
+	//when the next endpoint may be attempted
+	uint64 next = now;
+	std::vector<PollDescriptor> pending;
+	SOCKET winner = INVALID_SOCKET;
+	int32 started = 0;
+	int error = ConnectTimedOut;
+
+	while( winner == INVALID_SOCKET ) {
+		now = Milliseconds();
+		if( timeout >= 0 && now >= deadline ) {
+			error = ConnectTimedOut;
+			break;
+		}
+
+		if( started < count && now >= next ) {
+			bool connected = false;
+			SOCKET descriptor = StartConnect(endPoints[started++], connected, error);
+			if( connected == true ) {
+				winner = descriptor;
+			} else if( descriptor != INVALID_SOCKET ) {
+				PollDescriptor attempt;
+				attempt.fd = descriptor;
+				attempt.events = POLLOUT;
+				attempt.revents = 0;
+				pending.push_back(attempt);
+				next = now + ConnectStagger;
+			}
+			continue;
+		}
+		if( pending.empty() == true )
+			break;
+
+		int wait = started < count ? (int)(next - now) : -1;
+		if( timeout >= 0 && (wait < 0 || deadline - now < (uint64)wait) )
+			wait = (int)(deadline - now);
+		#if PLATFORM == PLATFORM_WIN32
+		int num = WSAPoll(&pending[0], (ULONG)pending.size(), wait);
+		#elif PLATFORM == PLATFORM_LINUX
+		int num = poll(&pending[0], pending.size(), wait);
+		#endif
+		if( num == SOCKET_ERROR ) {
+			if( LastError() == EINTR )
+				continue;
+			error = LastError();
+			break;
+		}
+
+		for( size_t i = 0; i < pending.size() && num > 0 && winner == INVALID_SOCKET; ) {
+			if( pending[i].revents == 0 ) {
+				i++;
+				continue;
+			}
+			num--;
+
+			int result = 0; socklen_t length = sizeof(result);
+			if( getsockopt(pending[i].fd, SOL_SOCKET, SO_ERROR, (char*)&result, &length) != 0 )
+				result = LastError();
+			if( result == 0 ) {
+				winner = pending[i].fd;
+			} else {
+				//a failed attempt lets the next endpoint start right away
+				error = result;
+				closesocket(pending[i].fd);
+				next = 0;
+			}
+			pending.erase(pending.begin() + i);
+		}
+	}
+
+	for( size_t i = 0; i < pending.size(); i++ )
+		closesocket(pending[i].fd);
+	if( winner == INVALID_SOCKET ) {
+		throw SocketException(resolveError(error));
+	}
+
+	//the unconnected descriptor is replaced by the winning one, which was created non-blocking
+	bool blocking = reinterpret_cast<Socket::Impl*>(&m_impl)->blocking == 1;
+	Close();
+	reinterpret_cast<Socket::Impl*>(&m_impl)->socket = winner;
+	reinterpret_cast<Socket::Impl*>(&m_impl)->adressFamilly = AdressFamilly::InterNetwork;
+	reinterpret_cast<Socket::Impl*>(&m_impl)->blocking = 0;
+	Blocking(blocking);
+	Adopt(reinterpret_cast<Socket::Impl*>(&m_impl));
+	countEstablished(SocketOperation::Connect, 1, begun);
+	countOpened(reinterpret_cast<Socket::Impl*>(&m_impl));
 }
 
 void Socket::Bind(const IPEndPoint& endPoint)
@@ -270,13 +1146,28 @@ void Socket::Bind(const IPEndPoint& endPoint)
 		#if PLATFORM == PLATFORM_WIN32 
 		int errorCode = WSAGetLastError();
 		throw SocketException(resolveError(errorCode));		
-		#elif
-		throw SocketException(0);		
+		#elif PLATFORM == PLATFORM_LINUX
+		int errorCode = errno;
+		throw SocketException(resolveError(errorCode));		
 		#endif		
 	}
 	#endif
 }	
 
+void Socket::Bind( const UnixEndPoint& endPoint )
+{
+	#if PLATFORM == PLATFORM_WIN32
+	throw SocketException("Operation has not been implemented.");
+	#elif PLATFORM == PLATFORM_LINUX
+	sockaddr_un local;
+	socklen_t length = ToAddress(endPoint, local);
+	if( bind(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&local, length) != 0 ) {
+		int errorCode = errno;
+		throw SocketException(resolveError(errorCode));
+	}
+	#endif
+}
+
 void Socket::Listen(int backlog)
 {
 	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX
@@ -285,16 +1176,62 @@ void Socket::Listen(int backlog)
 		#if PLATFORM == PLATFORM_WIN32 
 		int errorCode = WSAGetLastError();
 		throw SocketException(resolveError(errorCode));		
-		#elif
-		throw SocketException(0);		
+		#elif PLATFORM == PLATFORM_LINUX
+		int errorCode = errno;
+		throw SocketException(resolveError(errorCode));		
 		#endif		
 	}
 	#endif
 }
 
 
+namespace
+{
+	//SO_RCVTIMEO and SO_SNDTIMEO take milliseconds on windows and a timeval on linux
+	int GetTimeout(SOCKET socket, int name)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		uint32 timeout; socklen_t l = sizeof(timeout);
+		if( getsockopt(socket, SOL_SOCKET, name, (char*)&timeout, &l) != -1) {
+			return timeout;
+		}
+		#elif PLATFORM == PLATFORM_LINUX
+		timeval timeout; socklen_t l = sizeof(timeout);
+		if( getsockopt(socket, SOL_SOCKET, name, (char*)&timeout, &l) != -1) {
+			return (int)(timeout.tv_sec * 1000 + timeout.tv_usec / 1000);
+		}
+		#endif
+		return -1;
+	}
+
+	int SetTimeout(SOCKET socket, int name, int timeout)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		return setsockopt(socket, SOL_SOCKET, name, (char*)&timeout, sizeof( timeout ));
+		#elif PLATFORM == PLATFORM_LINUX
+		timeval value;
+		value.tv_sec = timeout / 1000;
+		value.tv_usec = (timeout % 1000) * 1000;
+		return setsockopt(socket, SOL_SOCKET, name, (char*)&value, sizeof( value ));
+		#endif
+	}
+}
+
 void Socket::Close( int timeout )
 {
+	countClosed(reinterpret_cast<Socket::Impl*>(&m_impl));
+
+	//release any pending asynchronous operations
+	if( reinterpret_cast<Socket::Impl*>(&m_impl)->manager != 0x0 ) {
+		reinterpret_cast<Socket::Impl*>(&m_impl)->manager->Detach(*this);
+		reinterpret_cast<Socket::Impl*>(&m_impl)->manager = 0x0;
+	}
+	releaseCounters(reinterpret_cast<Socket::Impl*>(&m_impl));
+
+	//e.g. the placeholder a racing Connect replaces, no call is needed
+	if( reinterpret_cast<Socket::Impl*>(&m_impl)->socket == INVALID_SOCKET )
+		return;
+
 	if( timeout < 0 )
 	{
 		//close socket immediately
@@ -311,7 +1248,7 @@ void Socket::Close( int timeout )
 
 		#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX
 		//set the receive timeout 
-        if( setsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout)) != 0) {
+        if( SetTimeout(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SO_RCVTIMEO, timeout) != 0) {
 			closesocket(reinterpret_cast<Socket::Impl*>(&m_impl)->socket);  
 		}
 		//await any data & close it
@@ -335,95 +1272,789 @@ void Socket::Close( int timeout )
 		#endif
 
 	}
+	reinterpret_cast<Socket::Impl*>(&m_impl)->socket = INVALID_SOCKET;
+}
+
+void Socket::Close()
+{	
+	Close(-1);
+}
+
+int  Socket::ReceiveTimeout()
+{	
+	return GetTimeout(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SO_RCVTIMEO);
+}
+
+int  Socket::SendTimeout()
+{
+	return GetTimeout(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SO_SNDTIMEO);
+}
+void Socket::ReceiveTimeout(int timeout)
+{
+    if (timeout < -1)
+    {
+       return;
+    }
+	if (timeout == -1)
+	{
+        timeout = 0;
+    }
+
+	reinterpret_cast<Socket::Impl*>(&m_impl)->receiveTimeout = timeout;
+	SetTimeout(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SO_RCVTIMEO, timeout);
+}
+void Socket::SendTimeout(int timeout)
+{
+    if (timeout < -1)
+    {
+       return;
+    }
+	if (timeout == -1)
+	{
+        timeout = 0;
+    }
+
+	reinterpret_cast<Socket::Impl*>(&m_impl)->sendTimeout = timeout;
+	SetTimeout(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SO_SNDTIMEO, timeout);
+}
+
+int  Socket::IdleTimeout()
+{
+	return reinterpret_cast<Socket::Impl*>(&m_impl)->idleTimeout;
+}
+
+void Socket::IdleTimeout(int timeout)
+{
+	if( timeout < 0 ) {
+		throw SocketException("Argument timeout is out of range.");
+	}
+	reinterpret_cast<Socket::Impl*>(&m_impl)->idleTimeout = timeout;
+}
+
+int  Socket::Send( uint8* buffer, int32 offset, int32 size )
+{
+	int length = send(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)(buffer + offset), size, SendFlags);
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, size, errorCode);
+	if( length == SOCKET_ERROR ) {
+		throw SocketException(resolveError(errorCode));
+	}
+
+	return length;
+}
+
+int  Socket::Receive( uint8* buffer, int32 offset, int32 size )
+{
+	int length = recv(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)(buffer + offset), size, 0);
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, errorCode);
+	if( length == SOCKET_ERROR ) {
+		throw SocketException(resolveError(errorCode));
+	}
+
+	return length;
+}
+
+int  Socket::Send( const IoSlice* slices, int32 count )
+{
+	#if PLATFORM == PLATFORM_WIN32
+	DWORD sent = 0;
+	int length = WSASend(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (LPWSABUF)slices, count, &sent, 0, 0x0, 0x0) == SOCKET_ERROR ? SOCKET_ERROR : (int)sent;
+	#elif PLATFORM == PLATFORM_LINUX
+	STATIC_ASSERT(sizeof(IoSlice) == sizeof(iovec));
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = (iovec*)slices;
+	message.msg_iovlen = count;
+	ssize_t length = sendmsg(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, &message, SendFlags);
+	#endif
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, SizeOf(slices, count), errorCode);
+	if( length == SOCKET_ERROR ) {
+		throw SocketException(resolveError(errorCode));
+	}
+
+	return (int)length;
+}
+
+int  Socket::Receive( const IoSlice* slices, int32 count )
+{
+	#if PLATFORM == PLATFORM_WIN32
+	DWORD received = 0, flags = 0;
+	int length = WSARecv(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (LPWSABUF)slices, count, &received, &flags, 0x0, 0x0) == SOCKET_ERROR ? SOCKET_ERROR : (int)received;
+	#elif PLATFORM == PLATFORM_LINUX
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = (iovec*)slices;
+	message.msg_iovlen = count;
+	ssize_t length = recvmsg(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, &message, 0);
+	#endif
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, errorCode);
+	if( length == SOCKET_ERROR ) {
+		throw SocketException(resolveError(errorCode));
+	}
+
+	return (int)length;
+}
+
+int  Socket::Send( uint8* buffer, int32 offset, int32 size, SocketError::Enum& error )
+{
+	int length = send(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)(buffer + offset), size, SendFlags);
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, size, errorCode);
+	error = resolveSocketError(errorCode);
+	return length == SOCKET_ERROR ? 0 : length;
+}
+
+int  Socket::Receive( uint8* buffer, int32 offset, int32 size, SocketError::Enum& error )
+{
+	int length = recv(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)(buffer + offset), size, 0);
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, errorCode);
+	error = resolveSocketError(errorCode);
+	return length == SOCKET_ERROR ? 0 : length;
+}
+
+int  Socket::Send( const IoSlice* slices, int32 count, SocketError::Enum& error )
+{
+	#if PLATFORM == PLATFORM_WIN32
+	DWORD sent = 0;
+	int length = WSASend(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (LPWSABUF)slices, count, &sent, 0, 0x0, 0x0) == SOCKET_ERROR ? SOCKET_ERROR : (int)sent;
+	#elif PLATFORM == PLATFORM_LINUX
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = (iovec*)slices;
+	message.msg_iovlen = count;
+	ssize_t length = sendmsg(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, &message, SendFlags);
+	#endif
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, SizeOf(slices, count), errorCode);
+	error = resolveSocketError(errorCode);
+	return length == SOCKET_ERROR ? 0 : (int)length;
+}
+
+int  Socket::Receive( const IoSlice* slices, int32 count, SocketError::Enum& error )
+{
+	#if PLATFORM == PLATFORM_WIN32
+	DWORD received = 0, flags = 0;
+	int length = WSARecv(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (LPWSABUF)slices, count, &received, &flags, 0x0, 0x0) == SOCKET_ERROR ? SOCKET_ERROR : (int)received;
+	#elif PLATFORM == PLATFORM_LINUX
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = (iovec*)slices;
+	message.msg_iovlen = count;
+	ssize_t length = recvmsg(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, &message, 0);
+	#endif
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, errorCode);
+	error = resolveSocketError(errorCode);
+	return length == SOCKET_ERROR ? 0 : (int)length;
+}
+
+int  Socket::SendDescriptors( uint8* buffer, int32 offset, int32 size, const int* descriptors, int32 count )
+{
+	if( size < 1 || count < 0 || count > MaxDescriptors ) {
+		throw SocketException("Argument size or count is out of range.");
+	}
+
+	#if PLATFORM == PLATFORM_WIN32
+	throw SocketException("Operation has not been implemented.");
+	#elif PLATFORM == PLATFORM_LINUX
+	iovec slice;
+	slice.iov_base = buffer + offset;
+	slice.iov_len = size;
+	union { char buffer[CMSG_SPACE(sizeof(int) * MaxDescriptors)]; cmsghdr align; } control;
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &slice;
+	message.msg_iovlen = 1;
+	if( count > 0 ) {
+		memset(&control, 0, sizeof(control));
+		message.msg_control = control.buffer;
+		message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+		cmsghdr* header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_SOCKET;
+		header->cmsg_type = SCM_RIGHTS;
+		header->cmsg_len = CMSG_LEN(sizeof(int) * count);
+		memcpy(CMSG_DATA(header), descriptors, sizeof(int) * count);
+	}
+	ssize_t length = sendmsg(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, &message, SendFlags);
+	int errorCode = length == SOCKET_ERROR ? errno : 0;
+	countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, size, errorCode);
+	if( length == SOCKET_ERROR ) {
+		throw SocketException(resolveError(errorCode));
+	}
+	return (int)length;
+	#endif
+}
+
+int  Socket::ReceiveDescriptors( uint8* buffer, int32 offset, int32 size, int* descriptors, int32& count )
+{
+	if( count < 0 ) {
+		throw SocketException("Argument count is out of range.");
+	}
+
+	#if PLATFORM == PLATFORM_WIN32
+	throw SocketException("Operation has not been implemented.");
+	#elif PLATFORM == PLATFORM_LINUX
+	int32 capacity = count;
+	iovec slice;
+	slice.iov_base = buffer + offset;
+	slice.iov_len = size;
+	union { char buffer[CMSG_SPACE(sizeof(int) * MaxDescriptors)]; cmsghdr align; } control;
+	msghdr message;
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &slice;
+	message.msg_iovlen = 1;
+	//without room for a control message the system closes the descriptors that arrive
+	if( capacity > 0 ) {
+		message.msg_control = control.buffer;
+		message.msg_controllen = CMSG_SPACE(sizeof(int) * (capacity < MaxDescriptors ? capacity : (int32)MaxDescriptors));
+	}
+	ssize_t length = recvmsg(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, &message, MSG_CMSG_CLOEXEC);
+	int errorCode = length == SOCKET_ERROR ? errno : 0;
+	countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, errorCode);
+	if( length == SOCKET_ERROR ) {
+		throw SocketException(resolveError(errorCode));
+	}
+
+	count = 0;
+	for( cmsghdr* header = CMSG_FIRSTHDR(&message); header != 0x0; header = CMSG_NXTHDR(&message, header) ) {
+		if( header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS )
+			continue;
+		int32 received = (int32)((header->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+		for( int32 i = 0; i < received; i++ ) {
+			int descriptor;
+			memcpy(&descriptor, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+			//the control buffer is padded, it may hold one descriptor more than asked for
+			if( count < capacity )
+				descriptors[count++] = descriptor;
+			else
+				closesocket(descriptor);
+		}
+	}
+	return (int)length;
+	#endif
+}
+
+int64 Socket::SendFile( int file, int64 offset, int64 length )
+{
+	#if PLATFORM == PLATFORM_WIN32
+	HANDLE handle = (HANDLE)_get_osfhandle(file);
+	LARGE_INTEGER position;
+	position.QuadPart = offset;
+	if( handle == INVALID_HANDLE_VALUE || SetFilePointerEx(handle, position, 0x0, FILE_BEGIN) == FALSE ) {
+		throw SocketException("The file descriptor is not valid.");
+	}
+
+	int64 sent = 0;
+	while( sent < length ) {
+		//TransmitFile sends at most 2GB per call
+		DWORD part = length - sent < 0x7ffff000 ? (DWORD)(length - sent) : 0x7ffff000;
+		if( TransmitFile(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, handle, part, 0, 0x0, 0x0, 0) == FALSE ) {
+			int errorCode = WSAGetLastError();
+			countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, SOCKET_ERROR, part, errorCode);
+			throw SocketException(resolveError(errorCode));
+		}
+		countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, part, part, 0);
+		sent += part;
+	}
+	return sent;
+	#elif PLATFORM == PLATFORM_LINUX
+	//the file is copied to the socket inside the kernel
+	off_t position = offset;
+	int64 sent = 0;
+	while( sent < length ) {
+		size_t part = length - sent < 0x7ffff000 ? (size_t)(length - sent) : 0x7ffff000;
+		ssize_t count = sendfile(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, file, &position, part);
+		int errorCode = count == SOCKET_ERROR ? errno : 0;
+		countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, count, part, errorCode);
+		if( count == SOCKET_ERROR ) {
+			if( errorCode == EINTR )
+				continue;
+			if( (errorCode == EAGAIN || errorCode == EWOULDBLOCK) && sent > 0 )
+				break;
+			throw SocketException(resolveError(errorCode));
+		}
+		//end of file
+		if( count == 0 )
+			break;
+		sent += count;
+	}
+	return sent;
+	#endif
+}
+
+int  Socket::SendTo( uint8* buffer, int32 offset, int32 size, const IPEndPoint& remoteEP )
+{
+	sockaddr_in remote = ToAddress(remoteEP);
+	int length = sendto(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)(buffer + offset), size, 0, (sockaddr*)&remote, sizeof(remote));
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, size, errorCode);
+	if( length == SOCKET_ERROR ) {
+		throw SocketException(resolveError(errorCode));
+	}
+
+	return length;
+}
+
+int  Socket::ReceiveFrom( uint8* buffer, int32 offset, int32 size, IPEndPoint& remoteEP )
+{
+	sockaddr_in remote; socklen_t remoteLength = sizeof(remote);
+	int length = recvfrom(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)(buffer + offset), size, 0, (sockaddr*)&remote, &remoteLength);
+	int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+	countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, errorCode);
+	if( length == SOCKET_ERROR ) {
+		throw SocketException(resolveError(errorCode));
+	}
+
+	remoteEP = IPEndPoint(remote.sin_addr.s_addr, ntohs(remote.sin_port));
+	return length;
+}
+
+int  Socket::SendTo( const Datagram* datagrams, int32 count )
+{
+	int sent = 0;
+	#if PLATFORM == PLATFORM_WIN32
+	for( ; sent < count; sent++ ) {
+		sockaddr_in remote = ToAddress(datagrams[sent].endPoint);
+		int length = sendto(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)datagrams[sent].buffer, datagrams[sent].size, 0, (sockaddr*)&remote, sizeof(remote));
+		int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+		countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, datagrams[sent].size, errorCode);
+		if( length == SOCKET_ERROR ) {
+			if( sent > 0 )
+				break;
+			throw SocketException(resolveError(errorCode));
+		}
+	}
+	#elif PLATFORM == PLATFORM_LINUX
+	mmsghdr messages[DatagramBatch];
+	iovec vectors[DatagramBatch];
+	sockaddr_in remotes[DatagramBatch];
+	while( sent < count ) {
+		int batch = count - sent < DatagramBatch ? count - sent : DatagramBatch;
+		memset(messages, 0, sizeof(mmsghdr) * batch);
+		for( int i = 0; i < batch; i++ ) {
+			const Datagram& datagram = datagrams[sent + i];
+			remotes[i] = ToAddress(datagram.endPoint);
+			vectors[i].iov_base = datagram.buffer;
+			vectors[i].iov_len = datagram.size;
+			messages[i].msg_hdr.msg_name = &remotes[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+
+		int num = sendmmsg(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, messages, batch, 0);
+		//counted per datagram, the failure as a single call
+		if( num == SOCKET_ERROR ) {
+			int errorCode = errno;
+			countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, SOCKET_ERROR, datagrams[sent].size, errorCode);
+			if( sent > 0 )
+				break;
+			throw SocketException(resolveError(errorCode));
+		}
+		for( int i = 0; i < num; i++ )
+			countSend(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, messages[i].msg_len, datagrams[sent + i].size, 0);
+		sent += num;
+		if( num < batch )
+			break;
+	}
+	#endif
+
+	return sent;
+}
+
+int  Socket::ReceiveFrom( Datagram* datagrams, int32 count )
+{
+	int received = 0;
+	#if PLATFORM == PLATFORM_WIN32
+	for( ; received < count; received++ ) {
+		//only the first datagram is waited for
+		u_long pending = 0;
+		if( received > 0 && (ioctlsocket(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, FIONREAD, &pending) != 0 || pending == 0) )
+			break;
+		sockaddr_in remote; int remoteLength = sizeof(remote);
+		int length = recvfrom(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)datagrams[received].buffer, datagrams[received].size, 0, (sockaddr*)&remote, &remoteLength);
+		int errorCode = length == SOCKET_ERROR ? WSAGetLastError() : 0;
+		countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, length, errorCode);
+		if( length == SOCKET_ERROR ) {
+			if( received > 0 )
+				break;
+			throw SocketException(resolveError(errorCode));
+		}
+		datagrams[received].length = length;
+		datagrams[received].segmentSize = 0;
+		datagrams[received].endPoint = IPEndPoint(remote.sin_addr.s_addr, ntohs(remote.sin_port));
+	}
+	#elif PLATFORM == PLATFORM_LINUX
+	mmsghdr messages[DatagramBatch];
+	iovec vectors[DatagramBatch];
+	sockaddr_in remotes[DatagramBatch];
+	union { char buffer[CMSG_SPACE(sizeof(int))]; cmsghdr align; } controls[DatagramBatch];
+	while( received < count ) {
+		int batch = count - received < DatagramBatch ? count - received : DatagramBatch;
+		memset(messages, 0, sizeof(mmsghdr) * batch);
+		for( int i = 0; i < batch; i++ ) {
+			vectors[i].iov_base = datagrams[received + i].buffer;
+			vectors[i].iov_len = datagrams[received + i].size;
+			messages[i].msg_hdr.msg_name = &remotes[i];
+			messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+			messages[i].msg_hdr.msg_control = controls[i].buffer;
+			messages[i].msg_hdr.msg_controllen = sizeof(controls[i].buffer);
+		}
+
+		//only the first datagram is waited for
+		int num = recvmmsg(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, messages, batch, received == 0 ? MSG_WAITFORONE : MSG_DONTWAIT, 0x0);
+		if( num == SOCKET_ERROR ) {
+			int errorCode = errno;
+			countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, SOCKET_ERROR, errorCode);
+			if( received > 0 )
+				break;
+			throw SocketException(resolveError(errorCode));
+		}
+
+		for( int i = 0; i < num; i++ ) {
+			Datagram& datagram = datagrams[received + i];
+			countReceive(reinterpret_cast<Socket::Impl*>(&m_impl)->counters, messages[i].msg_len, 0);
+			datagram.length = messages[i].msg_len;
+			datagram.segmentSize = 0;
+			datagram.endPoint = IPEndPoint(remotes[i].sin_addr.s_addr, ntohs(remotes[i].sin_port));
+			for( cmsghdr* control = CMSG_FIRSTHDR(&messages[i].msg_hdr); control != 0x0; control = CMSG_NXTHDR(&messages[i].msg_hdr, control) ) {
+				if( control->cmsg_level == SOL_UDP && control->cmsg_type == UDP_GRO )
+					memcpy(&datagram.segmentSize, CMSG_DATA(control), sizeof(int));
+			}
+		}
+		received += num;
+		if( num < batch )
+			break;
+	}
+	#endif
+
+	return received;
+}
+
+int  Socket::SegmentSize()
+{
+	int size = 0;
+	#if PLATFORM == PLATFORM_WIN32
+	DWORD value = 0; int l = sizeof(value);
+	if( getsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char*)&value, &l) == 0 )
+		size = (int)value;
+	#elif PLATFORM == PLATFORM_LINUX
+	socklen_t l = sizeof(size);
+	if( getsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_UDP, UDP_SEGMENT, (char*)&size, &l) != 0 )
+		size = 0;
+	#endif
+	return size;
+}
+
+void Socket::SegmentSize(int size)
+{
+	#if PLATFORM == PLATFORM_WIN32
+	DWORD value = size;
+	if( setsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_UDP, UDP_SEND_MSG_SIZE, (char*)&value, sizeof(value)) != 0 ) {
+	#elif PLATFORM == PLATFORM_LINUX
+	if( setsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_UDP, UDP_SEGMENT, (char*)&size, sizeof(size)) != 0 ) {
+	#endif
+		int errorCode = WSAGetLastError();
+		throw SocketException(resolveError(errorCode));
+	}
+}
+
+bool Socket::ReceiveCoalescing()
+{
+	#if PLATFORM == PLATFORM_WIN32
+	DWORD value = 0; int l = sizeof(value);
+	return getsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_UDP, UDP_RECV_MAX_COALESCED_SIZE, (char*)&value, &l) == 0 && value != 0;
+	#elif PLATFORM == PLATFORM_LINUX
+	int value = 0; socklen_t l = sizeof(value);
+	return getsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_UDP, UDP_GRO, (char*)&value, &l) == 0 && value != 0;
+	#endif
+}
+
+void Socket::ReceiveCoalescing(bool enabled)
+{
+	#if PLATFORM == PLATFORM_WIN32
+	DWORD value = enabled == true ? 0xffff : 0;
+	if( setsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_UDP, UDP_RECV_MAX_COALESCED_SIZE, (char*)&value, sizeof(value)) != 0 ) {
+	#elif PLATFORM == PLATFORM_LINUX
+	int value = enabled == true ? 1 : 0;
+	if( setsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_UDP, UDP_GRO, (char*)&value, sizeof(value)) != 0 ) {
+	#endif
+		int errorCode = WSAGetLastError();
+		throw SocketException(resolveError(errorCode));
+	}
+}
+
+bool Socket::ZeroCopy()
+{
+	return reinterpret_cast<Socket::Impl*>(&m_impl)->zeroCopy == 1;
+}
+
+void Socket::ZeroCopy(bool enabled)
+{
+	#if PLATFORM == PLATFORM_LINUX
+	int value = enabled == true ? 1 : 0;
+	if( enabled == true && setsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_ZEROCOPY, (char*)&value, sizeof(value)) != 0 ) {
+		int errorCode = errno;
+		throw SocketException(resolveError(errorCode));
+	}
+	reinterpret_cast<Socket::Impl*>(&m_impl)->zeroCopy = value;
+	#else
+	if( enabled == true ) {
+		throw SocketException("Operation has not been implemented.");
+	}
+	#endif
+}
+
+namespace
+{
+	//options that are plain ints on both platforms, getters report 0 when the option cannot be read
+	int GetOption(SOCKET socket, int level, int name)
+	{
+		int value = 0; socklen_t l = sizeof(value);
+		if( getsockopt(socket, level, name, (char*)&value, &l) != 0 )
+			return 0;
+		return value;
+	}
+
+	void SetOption(SOCKET socket, int level, int name, int value)
+	{
+		if( setsockopt(socket, level, name, (char*)&value, sizeof(value)) != 0 ) {
+			int errorCode = WSAGetLastError();
+			throw SocketException(resolveError(errorCode));
+		}
+	}
+}
+
+bool Socket::NoDelay()
+{
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_NODELAY) != 0;
+}
+
+void Socket::NoDelay(bool enabled)
+{
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_NODELAY, enabled == true ? 1 : 0);
+}
+
+bool Socket::Cork()
+{
+	#if PLATFORM == PLATFORM_LINUX
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_CORK) != 0;
+	#else
+	return false;
+	#endif
+}
+
+void Socket::Cork(bool enabled)
+{
+	#if PLATFORM == PLATFORM_LINUX
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_CORK, enabled == true ? 1 : 0);
+	#else
+	if( enabled == true ) {
+		throw SocketException("Operation has not been implemented.");
+	}
+	#endif
+}
+
+int  Socket::SendBufferSize()
+{
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_SNDBUF);
+}
+
+void Socket::SendBufferSize(int size)
+{
+	if( size < 0 ) {
+		throw SocketException("Argument size is out of range.");
+	}
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_SNDBUF, size);
+}
+
+int  Socket::ReceiveBufferSize()
+{
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_RCVBUF);
+}
+
+void Socket::ReceiveBufferSize(int size)
+{
+	if( size < 0 ) {
+		throw SocketException("Argument size is out of range.");
+	}
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_RCVBUF, size);
+}
+
+bool Socket::QuickAck()
+{
+	#if PLATFORM == PLATFORM_LINUX
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_QUICKACK) != 0;
+	#else
+	return false;
+	#endif
+}
+
+void Socket::QuickAck(bool enabled)
+{
+	#if PLATFORM == PLATFORM_LINUX
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_QUICKACK, enabled == true ? 1 : 0);
+	#else
+	if( enabled == true ) {
+		throw SocketException("Operation has not been implemented.");
+	}
+	#endif
+}
+
+int  Socket::BusyPoll()
+{
+	#if PLATFORM == PLATFORM_LINUX
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_BUSY_POLL);
+	#else
+	return 0;
+	#endif
+}
+
+void Socket::BusyPoll(int microSeconds)
+{
+	if( microSeconds < 0 ) {
+		throw SocketException("Argument microSeconds is out of range.");
+	}
+	#if PLATFORM == PLATFORM_LINUX
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_BUSY_POLL, microSeconds);
+	#else
+	if( microSeconds > 0 ) {
+		throw SocketException("Operation has not been implemented.");
+	}
+	#endif
+}
+
+int  Socket::FastOpen()
+{
+	#if PLATFORM == PLATFORM_LINUX
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_FASTOPEN);
+	#else
+	return 0;
+	#endif
+}
+
+void Socket::FastOpen(int queue)
+{
+	if( queue < 0 ) {
+		throw SocketException("Argument queue is out of range.");
+	}
+	#if PLATFORM == PLATFORM_LINUX
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_FASTOPEN, queue);
+	#else
+	if( queue > 0 ) {
+		throw SocketException("Operation has not been implemented.");
+	}
+	#endif
 }
 
-void Socket::Close()
-{	
-	Close(-1);
+bool Socket::FastOpenConnect()
+{
+	#if PLATFORM == PLATFORM_LINUX
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT) != 0;
+	#else
+	return false;
+	#endif
 }
 
-int  Socket::ReceiveTimeout()
-{	
-	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX
-	uint32 timeout; int l = sizeof(timeout);
-	if( getsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, &l) != -1) {
-		return timeout;
-	} else {
-		return -1;
+void Socket::FastOpenConnect(bool enabled)
+{
+	#if PLATFORM == PLATFORM_LINUX
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, enabled == true ? 1 : 0);
+	#else
+	if( enabled == true ) {
+		throw SocketException("Operation has not been implemented.");
 	}
 	#endif
 }
 
-int  Socket::SendTimeout()
+int  Socket::IncomingCpu()
 {
-	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX
-	uint32 timeout; int l = sizeof(timeout);
-	if( getsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_SNDTIMEO, (char*)&timeout, &l) != -1) {
-		return timeout;
-	} else {
+	#if PLATFORM == PLATFORM_LINUX
+	int cpu = -1; socklen_t l = sizeof(cpu);
+	if( getsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_INCOMING_CPU, (char*)&cpu, &l) != 0 )
 		return -1;
-	}
+	return cpu;
+	#else
+	return -1;
 	#endif
 }
-void Socket::ReceiveTimeout(int timeout)
-{
-    if (timeout < -1)
-    {
-       return;
-    }
-	if (timeout == -1)
-	{
-        timeout = 0;
-    }
 
-	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX
-	setsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof( timeout ));
+void Socket::IncomingCpu(int cpu)
+{
+	if( cpu < 0 ) {
+		throw SocketException("Argument cpu is out of range.");
+	}
+	#if PLATFORM == PLATFORM_LINUX
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_INCOMING_CPU, cpu);
+	#else
+	throw SocketException("Operation has not been implemented.");
 	#endif
 }
-void Socket::SendTimeout(int timeout)
+
+int  Socket::NotSentLowWatermark()
 {
-    if (timeout < -1)
-    {
-       return;
-    }
-	if (timeout == -1)
-	{
-        timeout = 0;
-    }
+	#if PLATFORM == PLATFORM_LINUX
+	return GetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT);
+	#else
+	return 0;
+	#endif
+}
 
-	#if PLATFORM == PLATFORM_WIN32 || PLATFORM == PLATFORM_LINUX
-	setsockopt(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, SOL_SOCKET, SO_SNDTIMEO, (char*)&timeout, sizeof( timeout ));
+void Socket::NotSentLowWatermark(int size)
+{
+	if( size < 0 ) {
+		throw SocketException("Argument size is out of range.");
+	}
+	#if PLATFORM == PLATFORM_LINUX
+	SetOption(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, IPPROTO_TCP, TCP_NOTSENT_LOWAT, size);
+	#else
+	throw SocketException("Operation has not been implemented.");
 	#endif
 }
 
-int  Socket::Send( uint8* buffer, int32 offset, int32 size )
+void Socket::Apply(const SocketOptions& options)
 {
-	int length = send(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)(buffer + offset), size, 0);
-	if( length == SOCKET_ERROR ) {
-		#if PLATFORM == PLATFORM_WIN32 
-		int errorCode = WSAGetLastError();
-		throw SocketException(resolveError(errorCode));		
-		#elif
-		throw SocketException(0);		
-		#endif	
+	const int flags[] = { options.noDelay, options.cork, options.quickAck };
+	for( int i = 0; i < 3; i++ ) {
+		if( flags[i] != SocketOptions::Unset && flags[i] != 0 && flags[i] != 1 ) {
+			throw SocketException("Argument options is out of range.");
+		}
 	}
 
-	return length;
+	if( options.noDelay != SocketOptions::Unset )
+		NoDelay(options.noDelay == 1);
+	if( options.cork != SocketOptions::Unset )
+		Cork(options.cork == 1);
+	if( options.sendBufferSize != SocketOptions::Unset )
+		SendBufferSize(options.sendBufferSize);
+	if( options.receiveBufferSize != SocketOptions::Unset )
+		ReceiveBufferSize(options.receiveBufferSize);
+	if( options.quickAck != SocketOptions::Unset )
+		QuickAck(options.quickAck == 1);
+	if( options.busyPoll != SocketOptions::Unset )
+		BusyPoll(options.busyPoll);
+	if( options.notSentLowWatermark != SocketOptions::Unset )
+		NotSentLowWatermark(options.notSentLowWatermark);
 }
 
-int  Socket::Receive( uint8* buffer, int32 offset, int32 size )
+namespace
 {
-	int length = recv(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (char*)(buffer + offset), size, 0);
-	if( length == SOCKET_ERROR ) {
-		#if PLATFORM == PLATFORM_WIN32 
-		int errorCode = WSAGetLastError();
-		throw SocketException(resolveError(errorCode));		
-		#elif
-		throw SocketException(0);		
-		#endif	
+	//the accepted socket is closed when the options cannot be applied, it would leak otherwise
+	void ApplyAccepted(Socket& accepted, const SocketOptions& options)
+	{
+		try {
+			accepted.Apply(options);
+		} catch( SocketException& ) {
+			accepted.Close();
+			throw;
+		}
 	}
-
-	return length;
 }
 
 bool Socket::Blocking()
@@ -433,45 +2064,66 @@ bool Socket::Blocking()
 
 void Socket::Blocking(bool blocking)
 {
+	//the mode is cached, only a change costs a call; FIONBIO also spares linux the F_GETFL/F_SETFL pair
 	int value = blocking == true ? 1 : 0;
 	if( reinterpret_cast<Socket::Impl*>(&m_impl)->blocking != value ) {
-		reinterpret_cast<Socket::Impl*>(&m_impl)->blocking = value;
-		if( blocking == true )
-		{
-			//remove non-blocking status
-			#if PLATFORM == PLATFORM_WIN32
-			u_long nonblocking = 0;
-			if( ioctlsocket(reinterpret_cast<Impl*>(&m_impl)->socket, FIONBIO, &nonblocking) != 0x0 ) {
-				int errorCode = WSAGetLastError();
-				throw SocketException(resolveError(errorCode));	
-			}
-			#elif PLATFORM == PLATFORM_LINUX
-			fcntl(s, F_SETFL, fcntl(reinterpret_cast<Impl*>(&m_impl)->socket, F_GETFL, 0) & ~O_NONBLOCK);
-			#endif
-		}
-		else
-		{
-			//add blocking status
-			#if PLATFORM == PLATFORM_WIN32
-			u_long nonblocking = 1;
-			if( ioctlsocket(reinterpret_cast<Impl*>(&m_impl)->socket, FIONBIO, &nonblocking) != 0x0 ) { 
-				int errorCode = WSAGetLastError();
-				throw SocketException(resolveError(errorCode));	
-			}
-			#elif PLATFORM == PLATFORM_LINUX
-			fcntl(s, F_SETFL, fcntl(reinterpret_cast<Impl*>(&m_impl)->socket, F_GETFL, 0) | O_NONBLOCK);
-			#endif
+		u_long nonblocking = blocking == true ? 0 : 1;
+		if( ioctlsocket(reinterpret_cast<Impl*>(&m_impl)->socket, FIONBIO, &nonblocking) != 0x0 ) {
+			int errorCode = WSAGetLastError();
+			throw SocketException(resolveError(errorCode));	
 		}
+		reinterpret_cast<Socket::Impl*>(&m_impl)->blocking = value;
 	}
 }
 
 
 bool Socket::Poll( int microSeconds, SelectMode::Enum mode)
 {
+	#if PLATFORM == PLATFORM_LINUX
+	//poll has no FD_SETSIZE limit on the descriptor value
+	pollfd fds;
+	fds.fd = reinterpret_cast<Socket::Impl*>(&m_impl)->socket;
+	fds.revents = 0;
+	switch(mode)
+	{
+		case SelectMode::SelectRead:
+			fds.events = POLLIN;
+			break;
+		case SelectMode::SelectWrite:
+			fds.events = POLLOUT;
+			break;
+		case SelectMode::SelectError:
+			fds.events = POLLPRI;
+			break;
+	}
+
+	int num = 0;
+	if (microSeconds != -1)
+	{
+		timespec socketTime;
+		socketTime.tv_sec = microSeconds / 1000000;
+		socketTime.tv_nsec = (microSeconds % 1000000) * 1000L;
+		num = ppoll(&fds, 1, &socketTime, 0x0);
+	}
+	else
+	{
+		num = ppoll(&fds, 1, 0x0, 0x0);
+	}
+
+	if (num == -1)
+	{
+		throw SocketException("Poll failed.");
+	}
+
+	if( mode == SelectMode::SelectError )
+		return (fds.revents & (POLLPRI | POLLERR)) != 0;
+	return fds.revents != 0;
+	#else
 	fd_set fds;
 	FD_ZERO(&fds);
 	FD_SET(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, &fds);
 
+	int nfds = (int)reinterpret_cast<Socket::Impl*>(&m_impl)->socket + 1;
 	int num = 0;
     if (microSeconds != -1)
     {		
@@ -482,13 +2134,13 @@ bool Socket::Poll( int microSeconds, SelectMode::Enum mode)
 		switch(mode)
 		{
 			case SelectMode::SelectRead:
-				num = select(0, &fds, 0, 0, &socketTime);
+				num = select(nfds, &fds, 0, 0, &socketTime);
 				break;
 			case SelectMode::SelectWrite:
-				num = select(0, 0, &fds, 0, &socketTime);
+				num = select(nfds, 0, &fds, 0, &socketTime);
 				break;
 			case SelectMode::SelectError:
-				num = select(0, 0, 0, &fds, &socketTime);
+				num = select(nfds, 0, 0, &fds, &socketTime);
 				break;
 		}		
     }
@@ -497,13 +2149,13 @@ bool Socket::Poll( int microSeconds, SelectMode::Enum mode)
         switch(mode)
 		{
 			case SelectMode::SelectRead:
-				num = select(0, &fds, 0, 0, 0);
+				num = select(nfds, &fds, 0, 0, 0);
 				break;
 			case SelectMode::SelectWrite:
-				num = select(0, 0, &fds, 0, 0);
+				num = select(nfds, 0, &fds, 0, 0);
 				break;
 			case SelectMode::SelectError:
-				num = select(0, 0, 0, &fds, 0);
+				num = select(nfds, 0, 0, &fds, 0);
 				break;
 		}
     }
@@ -513,20 +2165,15 @@ bool Socket::Poll( int microSeconds, SelectMode::Enum mode)
 		throw SocketException("Poll failed.");			
 	}
 
-	if ( fds.fd_count == 0x0 )
-    {
-        return false;
-    }
-
-	return fds.fd_array[0] == reinterpret_cast<Socket::Impl*>(&m_impl)->socket;
-
+	return FD_ISSET(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, &fds) != 0;
+	#endif
 }
 
 
 
 IPEndPoint const* Socket::LocalEndPoint(IPEndPoint& endPoint)
 {
-	sockaddr_in addr; int length = sizeof(sockaddr_in);
+	sockaddr_in addr; socklen_t length = sizeof(sockaddr_in);
     if (getsockname(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&addr, &length) == 0) {
 	   endPoint = IPEndPoint(addr.sin_addr.s_addr, ntohs( addr.sin_port ));
 	   return &endPoint;
@@ -537,7 +2184,7 @@ IPEndPoint const* Socket::LocalEndPoint(IPEndPoint& endPoint)
 
 IPEndPoint const* Socket::RemoteEndPoint(IPEndPoint& endPoint)
 {
-	sockaddr_in addr; int length = sizeof(sockaddr_in);
+	sockaddr_in addr; socklen_t length = sizeof(sockaddr_in);
     if (getpeername(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&addr, &length) == 0) {
 	   endPoint = IPEndPoint(addr.sin_addr.s_addr, ntohs( addr.sin_port ));
 	   return &endPoint;
@@ -546,17 +2193,136 @@ IPEndPoint const* Socket::RemoteEndPoint(IPEndPoint& endPoint)
 	return 0x0;
 }
 
+UnixEndPoint const* Socket::LocalEndPoint(UnixEndPoint& endPoint)
+{
+	#if PLATFORM == PLATFORM_LINUX
+	sockaddr_un addr; socklen_t length = sizeof(sockaddr_un);
+	if( getsockname(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&addr, &length) == 0 && addr.sun_family == AF_UNIX ) {
+		endPoint = FromAddress(addr, length);
+		return &endPoint;
+	}
+	#endif
+	return 0x0;
+}
+
+UnixEndPoint const* Socket::RemoteEndPoint(UnixEndPoint& endPoint)
+{
+	#if PLATFORM == PLATFORM_LINUX
+	sockaddr_un addr; socklen_t length = sizeof(sockaddr_un);
+	if( getpeername(reinterpret_cast<Socket::Impl*>(&m_impl)->socket, (sockaddr*)&addr, &length) == 0 && addr.sun_family == AF_UNIX ) {
+		endPoint = FromAddress(addr, length);
+		return &endPoint;
+	}
+	#endif
+	return 0x0;
+}
+
 
 
 
 IAsyncResult*  Socket::BeginSend( uint8* buffer, int32 offset, int32 size, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
 {
-	return manager.BeginSend(buffer,offset,size, state);
+	return BeginSend(buffer, offset, size, 0x0, state, manager);
 }	
 
 IAsyncResult*  Socket::BeginReceive( uint8* buffer, int32 offset, int32 size, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
 {
-	return manager.BeginReceive(buffer,offset,size, state);
+	return BeginReceive(buffer, offset, size, 0x0, state, manager);
+}
+
+IAsyncResult*  Socket::BeginSend( uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	Attach(manager);
+	return manager.BeginSend(*this, buffer,offset,size, callback, state);
+}	
+
+IAsyncResult*  Socket::BeginReceive( uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	Attach(manager);
+	return manager.BeginReceive(*this, buffer,offset,size, callback, state);
+}
+
+IAsyncResult*  Socket::BeginSend( const IoSlice* slices, int32 count, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	Attach(manager);
+	return manager.BeginSend(*this, slices, count, callback, state);
+}
+
+IAsyncResult*  Socket::BeginReceive( const IoSlice* slices, int32 count, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	Attach(manager);
+	return manager.BeginReceive(*this, slices, count, callback, state);
+}
+
+IAsyncResult*  Socket::BeginAccept( AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	return BeginAccept(1, callback, state, manager);
+}
+
+IAsyncResult*  Socket::BeginAccept( int32 capacity, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	if( capacity < 1 ) {
+		throw SocketException("Argument capacity is out of range.");
+	}
+	Attach(manager);
+	return manager.BeginAccept(*this, capacity, callback, state);
+}
+
+IAsyncResult*  Socket::BeginConnect( const IPEndPoint& endPoint, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	Attach(manager);
+	return manager.BeginConnect(*this, endPoint, callback, state);
+}
+
+IAsyncResult*  Socket::BeginConnect( const IPEndPoint* endPoints, int32 count, int timeout, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	if( count < 1 ) {
+		throw SocketException("Argument count is out of range.");
+	}
+
+	CheckRace(reinterpret_cast<Socket::Impl*>(&m_impl));
+
+	ConnectRace* race = new ConnectRace(manager, *this, callback, state);
+	race->endPoints.assign(endPoints, endPoints + count);
+	race->attempts.resize(count);
+	for( int32 i = 0; i < count; i++ )
+		race->attempts[i].race = race;
+
+	race->references = 1;
+	if( timeout >= 0 ) {
+		try {
+			manager.BeginTimer(timeout, &OnDeadline, race);
+		} catch( SocketException& ) {
+			delete race;
+			throw;
+		}
+		race->references++;
+	}
+	Start(race);
+	Release(race);
+	return race;
+}
+
+IAsyncResult*  Socket::BeginConnect( const char* hostname, int port, int timeout, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	CheckRace(reinterpret_cast<Socket::Impl*>(&m_impl));
+	ConnectRace* race = new ConnectRace(manager, *this, callback, state);
+	race->port = port;
+
+	//the deadline covers resolving the name as well
+	race->references = 2;
+	if( timeout >= 0 ) {
+		try {
+			manager.BeginTimer(timeout, &OnDeadline, race);
+		} catch( SocketException& ) {
+			delete race;
+			throw;
+		}
+		race->references++;
+	}
+	DnsResolver::Default().BeginGetHostAddresses(hostname, &OnResolved, race, manager);
+	Release(race);
+	return race;
 }
 
 int  Socket::EndSend( IAsyncResult* result )
@@ -568,22 +2334,157 @@ int  Socket::EndReceive( IAsyncResult* result )
 	return result->Manager().EndReceive( result );
 }
 
+Socket Socket::EndAccept( IAsyncResult* result )
+{
+	Socket accepted;
+	EndAccept( result, &accepted );
+	return accepted;
+}
+
+int  Socket::EndAccept( IAsyncResult* result, Socket* accepted )
+{
+	int count = result->Manager().EndAccept( result, accepted );
+	for( int i = 0; i < count; i++ ) {
+		reinterpret_cast<Socket::Impl*>(&accepted[i].m_impl)->adressFamilly = reinterpret_cast<Socket::Impl*>(&m_impl)->adressFamilly;
+		countOpened(reinterpret_cast<Socket::Impl*>(&accepted[i].m_impl));
+	}
+	return count;
+}
+
+void Socket::EndConnect( IAsyncResult* result )
+{
+	//connects over several endpoints are raced by Socket itself
+	//the winning attempt was counted when it ended and carried over to this socket
+	if( ConnectRace* race = dynamic_cast<ConnectRace*>(result) ) {
+		End(race);
+		return;
+	}
+	result->Manager().EndConnect( result );
+	countOpened(reinterpret_cast<Socket::Impl*>(&m_impl));
+}
+
+#if HAS_COROUTINES
+SocketTransferAwaiter Socket::AsyncSend( uint8* buffer, int32 offset, int32 size, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	return SocketTransferAwaiter(*this, manager, SocketOperation::Send, buffer, offset, size);
+}
+
+SocketTransferAwaiter Socket::AsyncReceive( uint8* buffer, int32 offset, int32 size, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	return SocketTransferAwaiter(*this, manager, SocketOperation::Receive, buffer, offset, size);
+}
+
+SocketAcceptAwaiter Socket::AsyncAccept( SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	return SocketAcceptAwaiter(*this, manager);
+}
+
+SocketConnectAwaiter Socket::AsyncConnect( const IPEndPoint& endPoint, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	return SocketConnectAwaiter(*this, manager, endPoint);
+}
+
+void SocketAwaiter::await_suspend(std::coroutine_handle<> handle)
+{
+	//the callback may resume the coroutine before Begin returns, the awaiter is not touched afterwards
+	continuation = handle;
+	switch( operation )
+	{
+		case SocketOperation::Send:
+			socket.BeginSend(buffer, offset, size, &SocketAwaiter::Resume, this, manager);
+			break;
+		case SocketOperation::Receive:
+			socket.BeginReceive(buffer, offset, size, &SocketAwaiter::Resume, this, manager);
+			break;
+		case SocketOperation::Accept:
+			socket.BeginAccept(&SocketAwaiter::Resume, this, manager);
+			break;
+		case SocketOperation::Connect:
+			socket.BeginConnect(endPoint, &SocketAwaiter::Resume, this, manager);
+			break;
+		default:
+			break;
+	}
+}
+
+void SocketAwaiter::Resume(IAsyncResult* result)
+{
+	SocketAwaiter* awaiter = reinterpret_cast<SocketAwaiter*>(result->AsyncState());
+	awaiter->result = result;
+	awaiter->continuation.resume();
+}
+
+int SocketTransferAwaiter::await_resume()
+{
+	return operation == SocketOperation::Send ? socket.EndSend(result) : socket.EndReceive(result);
+}
+
+Socket SocketAcceptAwaiter::await_resume()
+{
+	Socket accepted = socket.EndAccept(result);
+	if( options != 0x0 )
+		ApplyAccepted(accepted, *options);
+	return accepted;
+}
+
+void SocketConnectAwaiter::await_resume()
+{
+	socket.EndConnect(result);
+}
+#endif
+
+void Socket::Attach(SocketIOManager& manager)
+{
+	//a socket is serviced by a single manager until it is closed
+	if( reinterpret_cast<Socket::Impl*>(&m_impl)->manager == 0x0 ) {
+		reinterpret_cast<Socket::Impl*>(&m_impl)->manager = &manager;
+	} else if( reinterpret_cast<Socket::Impl*>(&m_impl)->manager != &manager ) {
+		throw SocketException("The socket is already bound to another SocketIOManager.");
+	}
+}
+
+
 
 TcpListener::TcpListener(IPAdress& adress, int port)
 {
 	STATIC_ASSERT(sizeof(Impl) <= sizeof(m_impl));
-	new (&m_impl) Impl(
-		Socket(AdressFamilly::InterNetwork, SocketType::Stream, ProtocolType::Tcp), 
-		IPEndPoint(adress.adress, port)
-	);
+	new (&m_impl) Impl(IPEndPoint(adress.adress, port));
 }
 
 TcpListener::TcpListener(IPEndPoint& endPoint)
 {
+	STATIC_ASSERT(sizeof(Impl) <= sizeof(m_impl));
+	new (&m_impl) Impl(endPoint);
+}
+
+TcpListener::TcpListener(const UnixEndPoint& endPoint, SocketType::Enum type/* = SocketType::Stream*/)
+{
+	STATIC_ASSERT(sizeof(Impl) <= sizeof(m_impl));
+	if( type != SocketType::Stream && type != SocketType::Seqpacket ) {
+		throw SocketException("Argument type is out of range.");
+	}
+	new (&m_impl) Impl(endPoint, type);
 }
 
 TcpListener::~TcpListener()
 {
+	Stop();
+	reinterpret_cast<Impl*>(&m_impl)->~Impl();
+}
+
+Socket& TcpListener::Server()
+{
+	return reinterpret_cast<Impl*>(&m_impl)->socket;
+}
+
+const SocketOptions& TcpListener::AcceptedOptions()
+{
+	return reinterpret_cast<Impl*>(&m_impl)->accepted;
+}
+
+void TcpListener::AcceptedOptions(const SocketOptions& options)
+{
+	reinterpret_cast<Impl*>(&m_impl)->accepted = options;
 }
 
 bool TcpListener::Pending()
@@ -600,9 +2501,50 @@ Socket TcpListener::Accept()
 {
 	Socket r;
 	reinterpret_cast<Impl*>(&m_impl)->socket.Accept(r);
+	ApplyAccepted(r, reinterpret_cast<Impl*>(&m_impl)->accepted);
 	return r;
 }
 
+IAsyncResult* TcpListener::BeginAcceptSocket( AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	return reinterpret_cast<Impl*>(&m_impl)->socket.BeginAccept(callback, state, manager);
+}
+
+Socket TcpListener::EndAcceptSocket( IAsyncResult* result )
+{
+	Socket r = reinterpret_cast<Impl*>(&m_impl)->socket.EndAccept(result);
+	ApplyAccepted(r, reinterpret_cast<Impl*>(&m_impl)->accepted);
+	return r;
+}
+
+int  TcpListener::AcceptSockets( Socket* accepted, int32 capacity )
+{
+	int count = reinterpret_cast<Impl*>(&m_impl)->socket.Accept(accepted, capacity);
+	for( int i = 0; i < count; i++ )
+		ApplyAccepted(accepted[i], reinterpret_cast<Impl*>(&m_impl)->accepted);
+	return count;
+}
+
+IAsyncResult* TcpListener::BeginAcceptSockets( int32 capacity, AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	return reinterpret_cast<Impl*>(&m_impl)->socket.BeginAccept(capacity, callback, state, manager);
+}
+
+int  TcpListener::EndAcceptSockets( IAsyncResult* result, Socket* accepted )
+{
+	int count = reinterpret_cast<Impl*>(&m_impl)->socket.EndAccept(result, accepted);
+	for( int i = 0; i < count; i++ )
+		ApplyAccepted(accepted[i], reinterpret_cast<Impl*>(&m_impl)->accepted);
+	return count;
+}
+
+#if HAS_COROUTINES
+SocketAcceptAwaiter TcpListener::AsyncAcceptSocket( SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	return SocketAcceptAwaiter(reinterpret_cast<Impl*>(&m_impl)->socket, manager, &reinterpret_cast<Impl*>(&m_impl)->accepted);
+}
+#endif
+
 void TcpListener::Start(int backlog)
 {
 	if ((backlog > 0x7fffffff) || (backlog < 0))
@@ -610,24 +2552,61 @@ void TcpListener::Start(int backlog)
         throw SocketException("Argument backlog is out of range.");
     }
 
-	reinterpret_cast<Impl*>(&m_impl)->socket.Bind(reinterpret_cast<Impl*>(&m_impl)->endPoint);
-	reinterpret_cast<Impl*>(&m_impl)->socket.Listen(backlog);
+	Impl* impl = reinterpret_cast<Impl*>(&m_impl);
+	if( reinterpret_cast<Socket::Impl*>(&impl->socket.m_impl)->adressFamilly == AdressFamilly::Unix ) {
+		impl->socket.Bind(impl->local);
+		impl->bound = impl->local.abstract == false;
+	} else {
+		impl->socket.Bind(impl->endPoint);
+	}
+	impl->socket.Listen(backlog);
 }
 
 void TcpListener::Stop()
 {
-	reinterpret_cast<Impl*>(&m_impl)->socket.Close();
+	Impl* impl = reinterpret_cast<Impl*>(&m_impl);
+	impl->socket.Close();
+	//a path left behind would make the next bind fail
+	#if PLATFORM == PLATFORM_LINUX
+	if( impl->bound == true )
+		unlink(impl->local.path);
+	#endif
+	impl->bound = false;
 }
 
 
 struct NullIOManager : SocketIOManager
 {
-	IAsyncResult* BeginSend( uint8* buffer, int32 offset, int32 size, void* state ) 
+	IAsyncResult* BeginTimer( int milliSeconds, AsyncCallback callback, void* state )
+	{
+		throw SocketException("Operation has not been implemented.");			
+	}
+	void EndTimer( IAsyncResult* result )
+	{
+		throw SocketException("Operation has not been implemented.");			
+	}
+	IAsyncResult* BeginSend( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state ) 
 	{	
 		throw SocketException("Operation has not been implemented.");			
 	}
 
-	IAsyncResult* BeginReceive( uint8* buffer, int32 offset, int32 size, void* state ) 
+	IAsyncResult* BeginReceive( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state ) 
+	{
+		throw SocketException("Operation has not been implemented.");			
+	}
+	IAsyncResult* BeginSend( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state ) 
+	{	
+		throw SocketException("Operation has not been implemented.");			
+	}
+	IAsyncResult* BeginReceive( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state ) 
+	{
+		throw SocketException("Operation has not been implemented.");			
+	}
+	IAsyncResult* BeginAccept( Socket& socket, int32 capacity, AsyncCallback callback, void* state ) 
+	{
+		throw SocketException("Operation has not been implemented.");			
+	}
+	IAsyncResult* BeginConnect( Socket& socket, const IPEndPoint& endPoint, AsyncCallback callback, void* state ) 
 	{
 		throw SocketException("Operation has not been implemented.");			
 	}
@@ -639,10 +2618,22 @@ struct NullIOManager : SocketIOManager
 	{
 		throw SocketException("Operation has not been implemented.");			
 	}
+	int  EndAccept( IAsyncResult* result, Socket* accepted ) 
+	{
+		throw SocketException("Operation has not been implemented.");			
+	}
+	void EndConnect( IAsyncResult* result ) 
+	{
+		throw SocketException("Operation has not been implemented.");			
+	}
 };
 
 SocketIOManager& SocketIOManager::Default()
 {
+	#if PLATFORM == PLATFORM_LINUX
+	static EpollIOManager manager;
+	#else
 	static NullIOManager manager;
+	#endif
 	return manager;
 }
\ No newline at end of file
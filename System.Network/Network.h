@@ -1,6 +1,19 @@
 #pragma once
 #include "Config.h"
 #include <stdexcept>
+#if HAS_COROUTINES
+#include <coroutine>
+#endif
+#if HAS_MOVE_SEMANTICS
+#include <utility>
+#endif
+
+//hands a Socket over to another one, so code builds with and without rvalue references
+#if HAS_MOVE_SEMANTICS
+#define SOCKET_MOVE(socket) std::move(socket)
+#else
+#define SOCKET_MOVE(socket) (socket)
+#endif
 
 namespace AdressFamilly
 {
@@ -96,6 +109,64 @@ namespace SelectMode
 	};
 }
 
+namespace SocketOperation
+{
+	enum Enum
+	{
+		Send,
+		Receive,
+		Accept,
+		Connect,
+		Timer
+	};
+}
+
+//outcome of the non-throwing Send/Receive/Accept/Connect overloads, the values are the WinSock codes
+namespace SocketError
+{
+	enum Enum
+	{
+		AccessDenied = 10013,
+		AddressAlreadyInUse = 10048,
+		AddressFamilyNotSupported = 10047,
+		AddressNotAvailable = 10049,
+		AlreadyInProgress = 10037,
+		ConnectionAborted = 10053,
+		ConnectionRefused = 10061,
+		ConnectionReset = 10054,
+		DestinationAddressRequired = 10039,
+		Fault = 10014,
+		HostDown = 10064,
+		HostUnreachable = 10065,
+		InProgress = 10036,
+		Interrupted = 10004,
+		InvalidArgument = 10022,
+		IsConnected = 10056,
+		MessageSize = 10040,
+		NetworkDown = 10050,
+		NetworkReset = 10052,
+		NetworkUnreachable = 10051,
+		NoBufferSpaceAvailable = 10055,
+		NotConnected = 10057,
+		NotSocket = 10038,
+		OperationAborted = 995,
+		OperationNotSupported = 10045,
+		ProtocolFamilyNotSupported = 10046,
+		ProtocolNotSupported = 10043,
+		ProtocolOption = 10042,
+		ProtocolType = 10041,
+		Shutdown = 10058,
+		SocketError = -1,
+		SocketNotSupported = 10044,
+		Success = 0,
+		TimedOut = 10060,
+		TooManyOpenSockets = 10024,
+		WouldBlock = 10035
+	};
+
+	//the description a SocketException for the error would carry
+	const char* Message(Enum error);
+}
 
 struct IPAdress
 {
@@ -125,76 +196,369 @@ struct IPEndPoint
 	std::string ToString() const;
 };
 
+//a local socket address, a path in the file system or a name in the abstract namespace of linux,
+//which needs no file and vanishes with the last socket bound to it
+struct UnixEndPoint
+{
+	//the longest path or name, sun_path keeps a terminating zero or the leading one of abstract names
+	static const int32 MaxLength = 107;
+	//abstract names are not zero terminated and may contain zeros
+	char	path[MaxLength + 1];
+	int32	length;
+	bool	abstract;
+	UnixEndPoint() : length(0), abstract(false) { path[0] = 0; }
+	UnixEndPoint( const char* path, bool abstract = false );
+	UnixEndPoint( const char* name, int32 length, bool abstract );
+	//abstract names are shown with a leading @
+	std::string ToString() const;
+};
+
+//a buffer of a scatter/gather operation, laid out as iovec on linux and WSABUF on windows
+//so that arrays of slices are handed to the kernel as is
+struct IoSlice
+{
+	#if PLATFORM == PLATFORM_WIN32
+	uint32	size;
+	uint8*	buffer;
+	#else
+	uint8*	buffer;
+	size_t	size;
+	#endif
+	IoSlice() { buffer = 0x0; size = 0; }
+	IoSlice( uint8* b, int32 s ) { buffer = b; size = s; }
+};
+
+//one datagram of a batched SendTo/ReceiveFrom
+struct Datagram
+{
+	uint8*		buffer;
+	//bytes to send, or the capacity of buffer when receiving
+	int32		size;
+	int32		length;
+	//segment size when the kernel coalesced several datagrams on receive, 0 otherwise
+	int32		segmentSize;
+	//destination when sending, source when receiving
+	IPEndPoint	endPoint;
+	Datagram() : buffer(0x0), size(0), length(0), segmentSize(0) { }
+	Datagram( uint8* b, int32 s ) : buffer(b), size(s), length(0), segmentSize(0) { }
+	Datagram( uint8* b, int32 s, const IPEndPoint& e ) : buffer(b), size(s), length(0), segmentSize(0), endPoint(e) { }
+};
+
+//per connection tcp options set with a single call, e.g. by a TcpListener on the sockets it
+//accepts; fields left at Unset keep the setting of the socket, booleans are 0 or 1
+struct SocketOptions
+{
+	enum { Unset = -1 };
+	int		noDelay;
+	int		cork;
+	int		sendBufferSize;
+	int		receiveBufferSize;
+	int		quickAck;
+	int		busyPoll;
+	int		notSentLowWatermark;
+	SocketOptions();
+};
+
+struct Socket;
 struct IAsyncResult;
+
+//invoked on the completing thread, typically calls the matching End method
+typedef void (*AsyncCallback)( IAsyncResult* result );
+
 struct SocketIOManager 
 {
 	static SocketIOManager& Default();
+	virtual ~SocketIOManager() { }
+
+	//completes on a manager thread once milliSeconds elapsed, EndTimer throws when the manager shut down first
+	virtual IAsyncResult* BeginTimer( int milliSeconds, AsyncCallback callback, void* state ) = 0;
+	virtual void EndTimer( IAsyncResult* result ) = 0;
 protected:
 	friend struct Socket;
-	virtual IAsyncResult* BeginSend( uint8* buffer, int32 offset, int32 size, void* state ) = 0x0;
-	virtual IAsyncResult* BeginReceive( uint8* buffer, int32 offset, int32 size, void* state ) = 0x0;	
-	virtual int  EndSend( IAsyncResult* result ) = 0x0;
-	virtual int  EndReceive( IAsyncResult* result ) = 0x0;	
+	virtual IAsyncResult* BeginSend( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state ) = 0;
+	virtual IAsyncResult* BeginReceive( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state ) = 0;	
+	//the slices are copied, the buffers they point at must stay valid until the operation ends
+	virtual IAsyncResult* BeginSend( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state ) = 0;
+	virtual IAsyncResult* BeginReceive( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state ) = 0;
+	virtual IAsyncResult* BeginAccept( Socket& socket, int32 capacity, AsyncCallback callback, void* state ) = 0;
+	virtual IAsyncResult* BeginConnect( Socket& socket, const IPEndPoint& endPoint, AsyncCallback callback, void* state ) = 0;
+	virtual int  EndSend( IAsyncResult* result ) = 0;
+	virtual int  EndReceive( IAsyncResult* result ) = 0;	
+	//returns the number of sockets written to accepted, at most the capacity passed to BeginAccept
+	virtual int  EndAccept( IAsyncResult* result, Socket* accepted ) = 0;
+	virtual void EndConnect( IAsyncResult* result ) = 0;
+	//called when a socket serviced by this manager is closed
+	virtual void Detach( Socket& socket ) { }
 };
 
 struct IAsyncResult
 {
-	virtual SocketIOManager& Manager() = 0x0;
-	virtual void* AsyncState() = 0x0;
-	virtual bool IsCompleted() = 0x0;
+	virtual ~IAsyncResult() { }
+	virtual SocketIOManager& Manager() = 0;
+	virtual void* AsyncState() = 0;
+	virtual bool IsCompleted() = 0;
 };
 
+#if HAS_COROUTINES
+//begins the operation when awaited and resumes the coroutine from the completion callback,
+//the socket and buffer must stay valid until the co_await returns
+struct SocketAwaiter
+{
+	Socket&				socket;
+	SocketIOManager&	manager;
+	SocketOperation::Enum operation;
+	uint8*				buffer;
+	int32				offset;
+	int32				size;
+	IPEndPoint			endPoint;
+	IAsyncResult*		result;
+	std::coroutine_handle<> continuation;
+
+	SocketAwaiter(Socket& s, SocketIOManager& m, SocketOperation::Enum o, uint8* b, int32 off, int32 sz, const IPEndPoint& e)
+		: socket(s), manager(m), operation(o), buffer(b), offset(off), size(sz), endPoint(e), result(0x0) { }
+
+	bool await_ready() { return false; }
+	void await_suspend(std::coroutine_handle<> handle);
+	static void Resume(IAsyncResult* result);
+};
+
+//co_await yields the bytes transferred
+struct SocketTransferAwaiter : SocketAwaiter
+{
+	SocketTransferAwaiter(Socket& s, SocketIOManager& m, SocketOperation::Enum o, uint8* b, int32 off, int32 sz)
+		: SocketAwaiter(s, m, o, b, off, sz, IPEndPoint()) { }
+	int await_resume();
+};
+
+//co_await yields the accepted socket
+struct SocketAcceptAwaiter : SocketAwaiter
+{
+	//applied to the accepted socket when set
+	const SocketOptions* options;
+	SocketAcceptAwaiter(Socket& s, SocketIOManager& m, const SocketOptions* o = 0x0)
+		: SocketAwaiter(s, m, SocketOperation::Accept, 0x0, 0, 0, IPEndPoint()), options(o) { }
+	Socket await_resume();
+};
+
+struct SocketConnectAwaiter : SocketAwaiter
+{
+	SocketConnectAwaiter(Socket& s, SocketIOManager& m, const IPEndPoint& e)
+		: SocketAwaiter(s, m, SocketOperation::Connect, 0x0, 0, 0, e) { }
+	void await_resume();
+};
+#endif
+
+/*
+	Owns its descriptor and closes it when destroyed. With rvalue references
+	a Socket is move-only, without them a copy takes the descriptor over the
+	way std::auto_ptr does; either way the source is left without one, as if
+	default constructed. Sockets can be kept by value in containers since
+	the managers look them up by descriptor, only SocketPoller holds on to
+	the Socket itself. A manager must outlive the sockets it serviced.
+*/
 struct Socket
 {
 	struct Impl;
-	aligned4<12> m_impl;
+	aligned8<40> m_impl;
 
 	void Accept(Socket& accepted);
+	//accepts the pending connections without blocking, returns the number written to accepted,
+	//descriptors the written sockets still held are closed
+	int  Accept(Socket* accepted, int32 capacity);
 	void Listen(int backlog);
 	void Shutdown( int shutdownKinds );
 	void Disconnect( bool reuseSocket );
 	void Connect( const IPAdress& adress, int port);
 	void Connect( const IPEndPoint& endPoint);	
+	//tries the addresses of the host in turn on this socket
 	void Connect( const char* hostadress, int port );
+	//races the endpoints with staggered starts and keeps the first connection to succeed,
+	//fails once every attempt failed or timeout milliseconds elapsed, -1 waits indefinitely;
+	//the winning descriptor replaces the one of the socket and keeps its timeouts, so the socket
+	//must be an unbound TCP socket and other options are set once it connected
+	void Connect( const IPEndPoint* endPoints, int32 count, int timeout );
+	void Connect( const char* hostadress, int port, int timeout );
 	void Bind(const IPEndPoint& endPoint);
+	//AF_UNIX sockets, stream or seqpacket; a path is not removed when the socket closes
+	void Connect( const UnixEndPoint& endPoint );
+	void Bind( const UnixEndPoint& endPoint );
 	bool Poll( int microSeconds, SelectMode::Enum mode);
 	void Close( int timeout );
 	void Close();
 
 	bool Blocking();
 	void Blocking(bool blocking);
+	//asynchronous sends are transmitted with MSG_ZEROCOPY, EndSend returns once the kernel released the buffer
+	bool ZeroCopy();
+	void ZeroCopy(bool enabled);
+	//also bound asynchronous receives and accepts, respectively sends and connects,
+	//which complete with a timeout error when they are still pending once it elapsed
 	int  ReceiveTimeout();
 	void ReceiveTimeout(int timeout);
 	int  SendTimeout();
 	void SendTimeout(int timeout);
+	//pending asynchronous operations complete with a timeout error once the socket saw no
+	//traffic for timeout milliseconds, 0 disables it
+	int  IdleTimeout();
+	void IdleTimeout(int timeout);
+	//disables Nagle's algorithm, small sends leave without waiting for outstanding acknowledgements
+	bool NoDelay();
+	void NoDelay(bool enabled);
+	//holds back partial segments until the cork is removed, linux only
+	bool Cork();
+	void Cork(bool enabled);
+	//kernel buffer sizes in bytes, linux reports twice the size set to account for its bookkeeping
+	int  SendBufferSize();
+	void SendBufferSize(int size);
+	int  ReceiveBufferSize();
+	void ReceiveBufferSize(int size);
+	//acknowledges received segments right away; the kernel falls back to delayed acknowledgements
+	//on its own, so latency sensitive receivers set it again after each receive, linux only
+	bool QuickAck();
+	void QuickAck(bool enabled);
+	//microseconds a blocking receive busy polls the device queue before it sleeps, 0 disables it, linux only
+	int  BusyPoll();
+	void BusyPoll(int microSeconds);
+	//on a socket about to listen, the number of pending TCP Fast Open connections, 0 disables it, linux only
+	int  FastOpen();
+	void FastOpen(int queue);
+	//Connect returns right away and the handshake carries the first Send in its SYN, linux only
+	bool FastOpenConnect();
+	void FastOpenConnect(bool enabled);
+	//on listeners of a SO_REUSEPORT group, connections arriving on that cpu go to this listener;
+	//reading it on a connection gives the cpu its packets were last processed on, linux only
+	int  IncomingCpu();
+	void IncomingCpu(int cpu);
+	//unsent bytes above which the socket does not poll writable, 0 leaves it to the system wide default, linux only
+	int  NotSentLowWatermark();
+	void NotSentLowWatermark(int size);
+	//sets the fields of options that are not Unset
+	void Apply(const SocketOptions& options);
 	int  Send( uint8* buffer, int32 offset, int32 size );
 	int  Receive( uint8* buffer, int32 offset, int32 size );
+	//gathers from/scatters into all slices with a single call
+	int  Send( const IoSlice* slices, int32 count );
+	int  Receive( const IoSlice* slices, int32 count );
+	//report failures through error instead of throwing and return 0 then, so WouldBlock and
+	//ConnectionReset cost no more than a successful call
+	int  Send( uint8* buffer, int32 offset, int32 size, SocketError::Enum& error );
+	int  Receive( uint8* buffer, int32 offset, int32 size, SocketError::Enum& error );
+	int  Send( const IoSlice* slices, int32 count, SocketError::Enum& error );
+	int  Receive( const IoSlice* slices, int32 count, SocketError::Enum& error );
+	//WouldBlock when no connection was pending
+	int  Accept( Socket* accepted, int32 capacity, SocketError::Enum& error );
+	//InProgress while the connect of a non-blocking socket is still pending
+	void Connect( const IPEndPoint& endPoint, SocketError::Enum& error );
+	//WouldBlock while the backlog of the listener is full
+	void Connect( const UnixEndPoint& endPoint, SocketError::Enum& error );
+	//the most descriptors linux passes with one message
+	static const int32 MaxDescriptors = 253;
+	//passes open descriptors along with the bytes over an AF_UNIX socket, at least one byte has to be sent;
+	//the sender keeps its descriptors open
+	int  SendDescriptors( uint8* buffer, int32 offset, int32 size, const int* descriptors, int32 count );
+	//count holds the capacity of descriptors and is set to the number received, which are close-on-exec
+	//and belong to the caller; descriptors beyond the capacity are closed
+	int  ReceiveDescriptors( uint8* buffer, int32 offset, int32 size, int* descriptors, int32& count );
+	//sends length bytes of the open file descriptor starting at offset, returns the bytes sent
+	int64 SendFile( int file, int64 offset, int64 length );
+	int  SendTo( uint8* buffer, int32 offset, int32 size, const IPEndPoint& remoteEP );
+	int  ReceiveFrom( uint8* buffer, int32 offset, int32 size, IPEndPoint& remoteEP );
+	//transfers a batch of datagrams per call, returns the number of datagrams transferred
+	int  SendTo( const Datagram* datagrams, int32 count );
+	int  ReceiveFrom( Datagram* datagrams, int32 count );
+	//UDP segmentation offload, sends larger than size are split into datagrams of size bytes, 0 disables it
+	int  SegmentSize();
+	void SegmentSize(int size);
+	//UDP receive offload, a received datagram may carry several segments of segmentSize bytes
+	bool ReceiveCoalescing();
+	void ReceiveCoalescing(bool enabled);
 	IPEndPoint const* RemoteEndPoint(IPEndPoint& endPoint);
 	IPEndPoint const* LocalEndPoint(IPEndPoint& endPoint);
+	UnixEndPoint const* RemoteEndPoint(UnixEndPoint& endPoint);
+	UnixEndPoint const* LocalEndPoint(UnixEndPoint& endPoint);
 	
 	IAsyncResult*  BeginSend( uint8* buffer, int32 offset, int32 size, void* state, SocketIOManager& manager = SocketIOManager::Default() );
 	IAsyncResult*  BeginReceive( uint8* buffer, int32 offset, int32 size, void* state, SocketIOManager& manager = SocketIOManager::Default() );	
+	IAsyncResult*  BeginSend( uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	IAsyncResult*  BeginReceive( uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );	
+	IAsyncResult*  BeginSend( const IoSlice* slices, int32 count, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	IAsyncResult*  BeginReceive( const IoSlice* slices, int32 count, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	IAsyncResult*  BeginAccept( AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	IAsyncResult*  BeginAccept( int32 capacity, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	IAsyncResult*  BeginConnect( const IPEndPoint& endPoint, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	//asynchronous Connect over several endpoints, the descriptor is replaced by the winning connection as above
+	IAsyncResult*  BeginConnect( const IPEndPoint* endPoints, int32 count, int timeout, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	//resolves through DnsResolver::Default() without blocking and races the addresses
+	IAsyncResult*  BeginConnect( const char* hostadress, int port, int timeout, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
 	int  EndSend( IAsyncResult* result );
 	int  EndReceive( IAsyncResult* result );	
+	Socket EndAccept( IAsyncResult* result );
+	int  EndAccept( IAsyncResult* result, Socket* accepted );
+	void EndConnect( IAsyncResult* result );
+
+	#if HAS_COROUTINES
+	SocketTransferAwaiter AsyncSend( uint8* buffer, int32 offset, int32 size, SocketIOManager& manager = SocketIOManager::Default() );
+	SocketTransferAwaiter AsyncReceive( uint8* buffer, int32 offset, int32 size, SocketIOManager& manager = SocketIOManager::Default() );
+	SocketAcceptAwaiter   AsyncAccept( SocketIOManager& manager = SocketIOManager::Default() );
+	SocketConnectAwaiter  AsyncConnect( const IPEndPoint& endPoint, SocketIOManager& manager = SocketIOManager::Default() );
+	#endif
 
 	Socket();
 	Socket(AdressFamilly::Enum familly, SocketType::Enum socketType, ProtocolType::Enum protocolType);
+	//creates the descriptor in the given mode, sockets meant for asynchronous or polled use
+	//skip switching the mode afterwards; on linux it takes a single socket call
+	Socket(AdressFamilly::Enum familly, SocketType::Enum socketType, ProtocolType::Enum protocolType, bool blocking);
 	~Socket();
+	#if HAS_MOVE_SEMANTICS
+	Socket(Socket&& other) noexcept;
+	Socket& operator=(Socket&& other) noexcept;
+	Socket(const Socket&) = delete;
+	Socket& operator=(const Socket&) = delete;
+	#else
+	Socket(const Socket& other);
+	Socket& operator=(const Socket& other);
+	#endif
+	//whether the socket holds a descriptor
+	bool Valid();
+	//the native descriptor, -1 without one, e.g. to index per connection state
+	int64 Descriptor();
+
+private:
+	void Attach( SocketIOManager& manager );
 };
 
 struct TcpListener
 {	
 	struct Impl;	
-	aligned4<32> m_impl;
+	aligned8<216> m_impl;
 
 	TcpListener(IPAdress& adress, int port);
 	TcpListener(IPEndPoint& endPoint);
+	//listens on an AF_UNIX socket of type Stream or Seqpacket, Stop removes the path it created
+	TcpListener(const UnixEndPoint& endPoint, SocketType::Enum type = SocketType::Stream);
 	~TcpListener();
+	//the listening socket, e.g. to register it with a SocketPoller
+	Socket& Server();
+	//applied to every socket accepted through the listener
+	const SocketOptions& AcceptedOptions();
+	void AcceptedOptions(const SocketOptions& options);
 	bool Pending();
 	Socket Accept();
+	IAsyncResult* BeginAcceptSocket( AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	Socket EndAcceptSocket( IAsyncResult* result );
+	int  AcceptSockets( Socket* accepted, int32 capacity );
+	IAsyncResult* BeginAcceptSockets( int32 capacity, AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	int  EndAcceptSockets( IAsyncResult* result, Socket* accepted );
+	#if HAS_COROUTINES
+	SocketAcceptAwaiter AsyncAcceptSocket( SocketIOManager& manager = SocketIOManager::Default() );
+	#endif
 	void Start(int backlog);
 	void Start();
 	void Stop();
+
+private:
+	TcpListener(const TcpListener&);
+	TcpListener& operator=(const TcpListener&);
 };
 
 
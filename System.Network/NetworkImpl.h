@@ -0,0 +1,103 @@
+#pragma once
+#include "Network.h"
+
+#if PLATFORM == PLATFORM_WIN32
+#ifdef _WIN32_WINNT
+#undef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <mswsock.h>
+#include <io.h>
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "mswsock.lib")
+#elif PLATFORM == PLATFORM_LINUX
+#include <errno.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <ctime>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <netinet/tcp.h>
+#include <sys/sendfile.h>
+#include <netdb.h>
+#include <poll.h>
+#include <arpa/inet.h>
+
+typedef int SOCKET;
+typedef unsigned long u_long;
+#define INVALID_SOCKET	(-1)
+#define SOCKET_ERROR	(-1)
+#define SD_SEND			SHUT_WR
+
+//the winsock names map onto single posix calls
+inline int closesocket(SOCKET socket)
+{
+	return close(socket);
+}
+
+//FIONBIO and FIONREAD take an int on linux, u_long is twice its size there
+inline int ioctlsocket(SOCKET socket, unsigned long command, u_long* argument)
+{
+	int value = (int)*argument;
+	int result = ioctl(socket, command, &value);
+	*argument = (u_long)value;
+	return result;
+}
+
+inline int WSAGetLastError()
+{
+	return errno;
+}
+#endif
+
+#include <new>
+
+struct SocketCounters;
+
+struct Socket::Impl
+{
+	SOCKET socket;
+	int adressFamilly : 24;
+	unsigned blocking :  1;
+	//asynchronous sends use MSG_ZEROCOPY
+	unsigned zeroCopy :  1;
+	//counted as a live connection by IOStatistics
+	unsigned counted  :  1;
+	SocketIOManager* manager;
+	//milliseconds asynchronous operations may stay pending, 0 for no limit
+	int receiveTimeout;
+	int sendTimeout;
+	int idleTimeout;
+	//per-socket counters of IOStatistics, 0x0 unless the socket is tracked
+	SocketCounters* counters;
+};
+
+//leaves the socket as default constructed without closing the descriptor it held, e.g. after
+//the descriptor was handed to another socket
+void clearSocket(Socket::Impl* impl);
+
+const char* resolveError(int errorCode);
+SocketError::Enum resolveSocketError(int errorCode);
+
+//recording side of IOStatistics, length is SOCKET_ERROR when the call failed with errorCode, counters
+//are those of the socket when it is tracked
+void countSend(SocketCounters* counters, int64 length, int64 size, int errorCode);
+void countReceive(SocketCounters* counters, int64 length, int errorCode);
+//count connections were accepted or one was connected by a call that began at started, in nanoseconds
+void countEstablished(SocketOperation::Enum operation, int count, uint64 started);
+//a connection was handed to the socket, or the socket holding it was closed
+void countOpened(Socket::Impl* impl);
+void countClosed(Socket::Impl* impl);
+//frees the counters of a tracked socket once no manager counts into them
+void releaseCounters(Socket::Impl* impl);
@@ -0,0 +1,285 @@
+#include "Runtime.h"
+
+#if PLATFORM == PLATFORM_LINUX
+#include "EpollIOManager.h"
+#include "Threading.h"
+#include <deque>
+#include <vector>
+#include <sched.h>
+#include <unistd.h>
+
+namespace
+{
+	struct Job
+	{
+		Runtime::Task	task;
+		void*			state;
+	};
+
+	struct Worker
+	{
+		Runtime::Impl*	runtime;
+		int				index;
+		Thread			thread;
+		//the owner pops from the back, thieves from the front
+		Mutex			mutex;
+		std::deque<Job>	jobs;
+	};
+
+	//the runtime and loop or worker the calling thread belongs to
+	THREAD_LOCAL Runtime::Impl*	currentRuntime = 0x0;
+	THREAD_LOCAL int			currentLoop = -1;
+	THREAD_LOCAL Worker*		currentWorker = 0x0;
+
+	int Cores()
+	{
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		return cores > 0 ? (int)cores : 1;
+	}
+}
+
+struct Runtime::Impl
+{
+	std::vector<EpollIOManager*> loops;
+	std::vector<Worker*> workers;
+	//round-robin positions of Assign and of spawns from outside the pool
+	unsigned	nextLoop;
+	unsigned	nextWorker;
+	//jobs queued over all workers and workers asleep, sleeping only changes with the lock held
+	int			queued;
+	int			sleeping;
+	bool		running;
+	Mutex		mutex;
+	Condition	condition;
+	//loops that still have to pin themselves
+	int			starting;
+
+	struct Pin
+	{
+		Impl*	runtime;
+		int		index;
+	};
+
+	static void OnPin(void* state)
+	{
+		Pin* pin = reinterpret_cast<Pin*>(state);
+		Impl* impl = pin->runtime;
+		cpu_set_t cores;
+		CPU_ZERO(&cores);
+		CPU_SET(pin->index % Cores(), &cores);
+		//without the permission to pin the loop simply floats
+		pthread_setaffinity_np(pthread_self(), sizeof(cores), &cores);
+		currentRuntime = impl;
+		currentLoop = pin->index;
+		delete pin;
+
+		ScopedLock lock(impl->mutex);
+		if( --impl->starting == 0 )
+			impl->condition.Broadcast();
+	}
+
+	void Queue(Worker* worker, const Job& job)
+	{
+		{
+			ScopedLock lock(worker->mutex);
+			worker->jobs.push_back(job);
+		}
+		__atomic_add_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+		if( __atomic_load_n(&sleeping, __ATOMIC_SEQ_CST) > 0 ) {
+			ScopedLock lock(mutex);
+			condition.Signal();
+		}
+	}
+
+	bool Take(Worker* worker, Job& job)
+	{
+		ScopedLock lock(worker->mutex);
+		if( worker->jobs.empty() == true )
+			return false;
+		job = worker->jobs.back();
+		worker->jobs.pop_back();
+		__atomic_sub_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+		return true;
+	}
+
+	bool Steal(Worker* thief, Job& job)
+	{
+		for( size_t i = 1; i < workers.size(); i++ ) {
+			Worker* victim = workers[(thief->index + i) % workers.size()];
+			ScopedLock lock(victim->mutex);
+			if( victim->jobs.empty() == false ) {
+				job = victim->jobs.front();
+				victim->jobs.pop_front();
+				__atomic_sub_fetch(&queued, 1, __ATOMIC_SEQ_CST);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	static void Run(void* argument)
+	{
+		Worker* worker = reinterpret_cast<Worker*>(argument);
+		Impl* impl = worker->runtime;
+		currentRuntime = impl;
+		currentWorker = worker;
+
+		for( ;; ) {
+			Job job;
+			if( impl->Take(worker, job) == true || impl->Steal(worker, job) == true ) {
+				job.task(job.state);
+				continue;
+			}
+
+			//announcing the sleep before looking at queued again pairs with Queue, which
+			//counts the job before looking at sleeping, so one of both sees the other
+			ScopedLock lock(impl->mutex);
+			__atomic_add_fetch(&impl->sleeping, 1, __ATOMIC_SEQ_CST);
+			while( impl->running == true && __atomic_load_n(&impl->queued, __ATOMIC_SEQ_CST) == 0 )
+				impl->condition.Wait(impl->mutex);
+			__atomic_sub_fetch(&impl->sleeping, 1, __ATOMIC_SEQ_CST);
+			if( impl->running == false && __atomic_load_n(&impl->queued, __ATOMIC_SEQ_CST) == 0 )
+				return;
+		}
+	}
+
+	void Start(int loopCount, int workerCount)
+	{
+		nextLoop = 0;
+		nextWorker = 0;
+		queued = 0;
+		sleeping = 0;
+		running = true;
+		starting = loopCount;
+
+		try {
+			for( int i = 0; i < loopCount; i++ )
+				loops.push_back(new EpollIOManager(1));
+		} catch( SocketException& ) {
+			Stop();
+			throw;
+		}
+		for( int i = 0; i < loopCount; i++ ) {
+			Pin* pin = new Pin();
+			pin->runtime = this;
+			pin->index = i;
+			loops[i]->Post(&OnPin, pin);
+		}
+		{
+			ScopedLock lock(mutex);
+			while( starting > 0 )
+				condition.Wait(mutex);
+		}
+
+		//every worker exists before the first one starts stealing
+		for( int i = 0; i < workerCount; i++ ) {
+			workers.push_back(new Worker());
+			workers.back()->runtime = this;
+			workers.back()->index = i;
+		}
+		for( int i = 0; i < workerCount; i++ ) {
+			if( workers[i]->thread.Start(&Run, workers[i]) == false ) {
+				Stop();
+				throw SocketException("Unable to start the worker thread.");
+			}
+		}
+	}
+
+	void Stop()
+	{
+		{
+			ScopedLock lock(mutex);
+			running = false;
+			condition.Broadcast();
+		}
+		for( size_t i = 0; i < workers.size(); i++ ) {
+			workers[i]->thread.Join();
+			delete workers[i];
+		}
+		workers.clear();
+		for( size_t i = 0; i < loops.size(); i++ )
+			delete loops[i];
+		loops.clear();
+	}
+};
+
+Runtime::Runtime()
+{
+	m_impl = new Impl();
+	try {
+		m_impl->Start(Cores(), Cores());
+	} catch( SocketException& ) {
+		delete m_impl;
+		throw;
+	}
+}
+
+Runtime::Runtime(int loops, int workers)
+{
+	if( loops < 1 || workers < 1 ) {
+		throw SocketException("Argument loops or workers is out of range.");
+	}
+
+	m_impl = new Impl();
+	try {
+		m_impl->Start(loops, workers);
+	} catch( SocketException& ) {
+		delete m_impl;
+		throw;
+	}
+}
+
+Runtime::~Runtime()
+{
+	m_impl->Stop();
+	delete m_impl;
+}
+
+int Runtime::Loops()
+{
+	return (int)m_impl->loops.size();
+}
+
+SocketIOManager& Runtime::Loop(int index)
+{
+	if( index < 0 || index >= (int)m_impl->loops.size() ) {
+		throw SocketException("Argument index is out of range.");
+	}
+	return *m_impl->loops[index];
+}
+
+SocketIOManager& Runtime::Assign()
+{
+	unsigned next = __atomic_fetch_add(&m_impl->nextLoop, 1, __ATOMIC_RELAXED);
+	return *m_impl->loops[next % m_impl->loops.size()];
+}
+
+int Runtime::CurrentLoop()
+{
+	return currentRuntime == m_impl ? currentLoop : -1;
+}
+
+void Runtime::Spawn(Task task, void* state)
+{
+	Job job;
+	job.task = task;
+	job.state = state;
+
+	//work spawned by a task stays with its worker until another one steals it
+	Worker* worker = currentWorker;
+	if( worker == 0x0 || worker->runtime != m_impl ) {
+		unsigned next = __atomic_fetch_add(&m_impl->nextWorker, 1, __ATOMIC_RELAXED);
+		worker = m_impl->workers[next % m_impl->workers.size()];
+	}
+	m_impl->Queue(worker, job);
+}
+
+void Runtime::Post(int loop, Task task, void* state)
+{
+	if( loop < 0 || loop >= (int)m_impl->loops.size() ) {
+		throw SocketException("Argument loop is out of range.");
+	}
+	m_impl->loops[loop]->Post(task, state);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+#include "Network.h"
+
+#if PLATFORM == PLATFORM_LINUX
+
+/*
+	Thread-per-core runtime. Every event loop is a single threaded
+	EpollIOManager pinned to its own core, and a connection is pinned to the
+	loop Assign hands out by passing that manager to all of its Begin calls,
+	so its completions never migrate between cores. CPU work that handlers
+	spawn runs on a separate pool of workers: each worker takes its own most
+	recently spawned task first and steals the oldest tasks of the others
+	when it runs dry, work spawned from outside the pool is spread over the
+	workers round-robin. Post hands a task back to a loop, for instance to
+	continue on the connection once spawned work completed.
+
+	The runtime must outlive the connections and tasks it services,
+	destroying it runs the queued tasks and then stops the loops.
+*/
+struct Runtime
+{
+	typedef void (*Task)(void* state);
+
+	struct Impl;
+	Impl* m_impl;
+
+	//a loop and a worker per online core
+	Runtime();
+	Runtime(int loops, int workers);
+	~Runtime();
+
+	int  Loops();
+	SocketIOManager& Loop(int index);
+	//the loop for a new connection, round-robin
+	SocketIOManager& Assign();
+	//index of the loop the calling thread runs, -1 on any other thread
+	int  CurrentLoop();
+
+	//runs the task on a worker
+	void Spawn(Task task, void* state);
+	//runs the task on the thread of the loop in the order posted, tasks still queued when the runtime is destroyed are dropped
+	void Post(int loop, Task task, void* state);
+
+private:
+	Runtime(const Runtime&);
+	Runtime& operator=(const Runtime&);
+};
+
+#endif
@@ -0,0 +1,345 @@
+#include "NetworkImpl.h"
+#include "SecureSocket.h"
+
+#if PLATFORM == PLATFORM_LINUX
+#include <linux/tls.h>
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/kdf.h>
+#include <string.h>
+#include <stdio.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+namespace
+{
+	const int32 MaxSecret = 48;
+
+	//a traffic secret of the handshake, as logged by OpenSSL
+	struct Secret
+	{
+		uint8	bytes[MaxSecret];
+		int32	size;
+	};
+
+	//the kernel takes one of these per direction
+	union CryptoInfo
+	{
+		tls12_crypto_info_aes_gcm_128 aes128;
+		tls12_crypto_info_aes_gcm_256 aes256;
+	};
+
+	//throws the pending OpenSSL error, or the description when there is none
+	void Raise(const char* description)
+	{
+		unsigned long error = ERR_get_error();
+		ERR_clear_error();
+		if( error == 0 ) {
+			throw SocketException(description);
+		}
+		char message[256];
+		snprintf(message, sizeof(message), "%s %s", description, ERR_reason_error_string(error) != 0x0 ? ERR_reason_error_string(error) : "");
+		throw SocketException(message);
+	}
+
+	int32 Hex(char c)
+	{
+		if( c >= '0' && c <= '9' )
+			return c - '0';
+		if( c >= 'a' && c <= 'f' )
+			return c - 'a' + 10;
+		if( c >= 'A' && c <= 'F' )
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	//HKDF-Expand-Label of RFC 8446 with an empty context
+	bool ExpandLabel(const EVP_MD* digest, const Secret& secret, const char* label, uint8* output, int32 size)
+	{
+		uint8 info[2 + 1 + 255 + 1];
+		int32 labelSize = (int32)strlen(label);
+		info[0] = (uint8)(size >> 8);
+		info[1] = (uint8)size;
+		info[2] = (uint8)(6 + labelSize);
+		memcpy(info + 3, "tls13 ", 6);
+		memcpy(info + 9, label, labelSize);
+		info[9 + labelSize] = 0;
+
+		EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, 0x0);
+		size_t length = size;
+		bool result = context != 0x0
+			&& EVP_PKEY_derive_init(context) > 0
+			&& EVP_PKEY_CTX_hkdf_mode(context, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0
+			&& EVP_PKEY_CTX_set_hkdf_md(context, digest) > 0
+			&& EVP_PKEY_CTX_set1_hkdf_key(context, secret.bytes, secret.size) > 0
+			&& EVP_PKEY_CTX_add1_hkdf_info(context, info, 10 + labelSize) > 0
+			&& EVP_PKEY_derive(context, output, &length) > 0
+			&& length == (size_t)size;
+		EVP_PKEY_CTX_free(context);
+		return result;
+	}
+
+	//derives the record key and nonce of a direction, the first record after the handshake has sequence number 0
+	socklen_t Derive(const SSL_CIPHER* cipher, const Secret& secret, CryptoInfo& info)
+	{
+		const EVP_MD* digest = SSL_CIPHER_get_handshake_digest(cipher);
+		uint8 iv[12];
+		memset(&info, 0, sizeof(info));
+		switch( SSL_CIPHER_get_id(cipher) & 0xffff ) {
+			case 0x1301:
+				info.aes128.info.version = TLS_1_3_VERSION;
+				info.aes128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+				if( ExpandLabel(digest, secret, "key", info.aes128.key, sizeof(info.aes128.key)) == false || ExpandLabel(digest, secret, "iv", iv, sizeof(iv)) == false )
+					return 0;
+				memcpy(info.aes128.salt, iv, sizeof(info.aes128.salt));
+				memcpy(info.aes128.iv, iv + sizeof(info.aes128.salt), sizeof(info.aes128.iv));
+				OPENSSL_cleanse(iv, sizeof(iv));
+				return sizeof(info.aes128);
+			case 0x1302:
+				info.aes256.info.version = TLS_1_3_VERSION;
+				info.aes256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+				if( ExpandLabel(digest, secret, "key", info.aes256.key, sizeof(info.aes256.key)) == false || ExpandLabel(digest, secret, "iv", iv, sizeof(iv)) == false )
+					return 0;
+				memcpy(info.aes256.salt, iv, sizeof(info.aes256.salt));
+				memcpy(info.aes256.iv, iv + sizeof(info.aes256.salt), sizeof(info.aes256.iv));
+				OPENSSL_cleanse(iv, sizeof(iv));
+				return sizeof(info.aes256);
+			default:
+				return 0;
+		}
+	}
+
+	int SecretIndex()
+	{
+		static int index = SSL_get_ex_new_index(0, 0x0, 0x0, 0x0, 0x0);
+		return index;
+	}
+
+	void Log(const SSL* ssl, const char* line);
+}
+
+struct SecureContext::Impl
+{
+	SSL_CTX*			context;
+	SecureRole::Enum	role;
+	//copied, the options may not outlive the context
+	char				serverName[256];
+	bool				verify;
+};
+
+struct SecureSocket::Impl
+{
+	Socket&			socket;
+	SecureContext&	context;
+	//the secrets of the traffic the client and the server send
+	Secret			client;
+	Secret			server;
+	const char*		cipher;
+
+	Impl(Socket& s, SecureContext& c) : socket(s), context(c), cipher(0x0)
+	{
+		client.size = server.size = 0;
+	}
+
+	~Impl()
+	{
+		OPENSSL_cleanse(&client, sizeof(client));
+		OPENSSL_cleanse(&server, sizeof(server));
+	}
+};
+
+namespace
+{
+	//OpenSSL has no accessor for the traffic secrets, they are picked up from the key log
+	void Log(const SSL* ssl, const char* line)
+	{
+		SecureSocket::Impl* impl = reinterpret_cast<SecureSocket::Impl*>(SSL_get_ex_data(ssl, SecretIndex()));
+		Secret* secret = 0x0;
+		if( strncmp(line, "CLIENT_TRAFFIC_SECRET_0 ", 24) == 0 )
+			secret = &impl->client;
+		else if( strncmp(line, "SERVER_TRAFFIC_SECRET_0 ", 24) == 0 )
+			secret = &impl->server;
+		else
+			return;
+
+		//the client random comes first
+		const char* hex = strchr(line + 24, ' ');
+		secret->size = 0;
+		if( hex == 0x0 )
+			return;
+		hex++;
+		int32 size = 0;
+		while( size < MaxSecret && Hex(hex[0]) >= 0 && Hex(hex[1]) >= 0 ) {
+			secret->bytes[size++] = (uint8)((Hex(hex[0]) << 4) | Hex(hex[1]));
+			hex += 2;
+		}
+		secret->size = size;
+	}
+}
+
+SecureContext::SecureContext( SecureRole::Enum role, const SecureOptions& options )
+{
+	if( role == SecureRole::Server && (options.certificateFile == 0x0 || options.privateKeyFile == 0x0) ) {
+		throw SocketException("A server requires a certificate and a private key.");
+	}
+	if( options.serverName != 0x0 && strlen(options.serverName) >= sizeof(((Impl*)0x0)->serverName) ) {
+		throw SocketException("Argument serverName is too long.");
+	}
+
+	SSL_CTX* context = SSL_CTX_new(role == SecureRole::Client ? TLS_client_method() : TLS_server_method());
+	if( context == 0x0 ) {
+		Raise("The TLS context could not be created.");
+	}
+	//the kernel offload covers the AES-GCM suites of TLS 1.3
+	SSL_CTX_set_min_proto_version(context, TLS1_3_VERSION);
+	SSL_CTX_set_ciphersuites(context, "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384");
+	//a ticket would be the first record the kernel decrypts, and it cannot
+	SSL_CTX_set_num_tickets(context, 0);
+	SSL_CTX_set_keylog_callback(context, &Log);
+
+	if( options.certificateFile != 0x0 && SSL_CTX_use_certificate_chain_file(context, options.certificateFile) != 1 ) {
+		SSL_CTX_free(context);
+		Raise("The certificate could not be loaded.");
+	}
+	if( options.privateKeyFile != 0x0 && (SSL_CTX_use_PrivateKey_file(context, options.privateKeyFile, SSL_FILETYPE_PEM) != 1 || SSL_CTX_check_private_key(context) != 1) ) {
+		SSL_CTX_free(context);
+		Raise("The private key could not be loaded.");
+	}
+	if( options.trustFile != 0x0 ) {
+		if( SSL_CTX_load_verify_locations(context, options.trustFile, 0x0) != 1 ) {
+			SSL_CTX_free(context);
+			Raise("The trusted certificates could not be loaded.");
+		}
+		SSL_CTX_set_verify(context, SSL_VERIFY_PEER | (role == SecureRole::Server ? SSL_VERIFY_FAIL_IF_NO_PEER_CERT : 0), 0x0);
+	}
+
+	m_impl = new Impl();
+	m_impl->context = context;
+	m_impl->role = role;
+	m_impl->verify = options.trustFile != 0x0;
+	m_impl->serverName[0] = 0;
+	if( options.serverName != 0x0 )
+		strcpy(m_impl->serverName, options.serverName);
+}
+
+SecureContext::~SecureContext()
+{
+	SSL_CTX_free(m_impl->context);
+	delete m_impl;
+}
+
+SecureRole::Enum SecureContext::Role()
+{
+	return m_impl->role;
+}
+
+SecureSocket::SecureSocket( Socket& socket, SecureContext& context )
+{
+	m_impl = new Impl(socket, context);
+}
+
+SecureSocket::~SecureSocket()
+{
+	delete m_impl;
+}
+
+void SecureSocket::Handshake()
+{
+	if( m_impl->cipher != 0x0 ) {
+		throw SocketException("The handshake already completed.");
+	}
+
+	int descriptor = (int)m_impl->socket.Descriptor();
+	//the upper layer protocol passes records through until keys are installed, so an unsupported kernel fails before the handshake
+	if( setsockopt(descriptor, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0 ) {
+		int errorCode = WSAGetLastError();
+		if( errorCode == ENOENT ) {
+			throw SocketException("The system does not support kernel TLS.");
+		}
+		throw SocketException(resolveError(errorCode));
+	}
+
+	SecureContext::Impl* context = m_impl->context.m_impl;
+	SSL* ssl = SSL_new(context->context);
+	if( ssl == 0x0 ) {
+		Raise("The TLS session could not be created.");
+	}
+	//the socket keeps its descriptor when the session is freed
+	SSL_set_fd(ssl, descriptor);
+	SSL_set_ex_data(ssl, SecretIndex(), m_impl);
+	if( context->serverName[0] != 0 && context->role == SecureRole::Client ) {
+		SSL_set_tlsext_host_name(ssl, context->serverName);
+		if( context->verify == true )
+			SSL_set1_host(ssl, context->serverName);
+	}
+
+	bool blocking = m_impl->socket.Blocking();
+	if( blocking == false )
+		m_impl->socket.Blocking(true);
+	int result = context->role == SecureRole::Client ? SSL_connect(ssl) : SSL_accept(ssl);
+	if( blocking == false )
+		m_impl->socket.Blocking(false);
+
+	if( result != 1 ) {
+		int error = SSL_get_error(ssl, result);
+		SSL_free(ssl);
+		if( error == SSL_ERROR_SYSCALL || error == SSL_ERROR_WANT_READ || error == SSL_ERROR_WANT_WRITE ) {
+			int errorCode = WSAGetLastError();
+			ERR_clear_error();
+			throw SocketException(errorCode != 0 ? resolveError(errorCode) : "The connection closed during the handshake.");
+		}
+		Raise("The TLS handshake failed.");
+	}
+
+	//the session sent and read exactly the handshake records, anything after them is left to the kernel
+	const SSL_CIPHER* cipher = SSL_get_current_cipher(ssl);
+	const char* name = SSL_CIPHER_get_name(cipher);
+	Secret& sending = context->role == SecureRole::Client ? m_impl->client : m_impl->server;
+	Secret& receiving = context->role == SecureRole::Client ? m_impl->server : m_impl->client;
+	CryptoInfo transmit, receive;
+	socklen_t transmitSize = sending.size > 0 ? Derive(cipher, sending, transmit) : 0;
+	socklen_t receiveSize = receiving.size > 0 ? Derive(cipher, receiving, receive) : 0;
+	SSL_free(ssl);
+	OPENSSL_cleanse(&sending, sizeof(sending));
+	OPENSSL_cleanse(&receiving, sizeof(receiving));
+
+	if( transmitSize == 0 || receiveSize == 0 ) {
+		OPENSSL_cleanse(&transmit, sizeof(transmit));
+		OPENSSL_cleanse(&receive, sizeof(receive));
+		throw SocketException("The traffic keys could not be derived.");
+	}
+	int transmitted = setsockopt(descriptor, SOL_TLS, TLS_TX, &transmit, transmitSize);
+	int received = transmitted == 0 ? setsockopt(descriptor, SOL_TLS, TLS_RX, &receive, receiveSize) : -1;
+	int errorCode = WSAGetLastError();
+	OPENSSL_cleanse(&transmit, sizeof(transmit));
+	OPENSSL_cleanse(&receive, sizeof(receive));
+	if( transmitted != 0 || received != 0 ) {
+		throw SocketException(resolveError(errorCode));
+	}
+	m_impl->cipher = name;
+}
+
+const char* SecureSocket::Cipher()
+{
+	return m_impl->cipher;
+}
+
+bool SecureSocket::Supported()
+{
+	//the module is loaded on first use, a missing one fails with ENOENT while an unconnected socket fails otherwise
+	static int supported = -1;
+	if( supported == -1 ) {
+		//e.g. out of descriptors, nothing is known then and the probe is repeated on the next call
+		int descriptor = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		if( descriptor == INVALID_SOCKET )
+			return false;
+		int result = setsockopt(descriptor, SOL_TCP, TCP_ULP, "tls", sizeof("tls"));
+		supported = result == 0 || WSAGetLastError() != ENOENT ? 1 : 0;
+		closesocket(descriptor);
+	}
+	return supported == 1;
+}
+
+#endif
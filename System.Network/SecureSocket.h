@@ -0,0 +1,80 @@
+#pragma once
+#include "Network.h"
+
+#if PLATFORM == PLATFORM_LINUX
+
+namespace SecureRole
+{
+	enum Enum
+	{
+		Client,
+		Server
+	};
+}
+
+struct SecureOptions
+{
+	//PEM files of the certificate chain and its private key, required for servers
+	const char*	certificateFile;
+	const char*	privateKeyFile;
+	//PEM file of the trusted certificates, the peer is only verified when it is set
+	const char*	trustFile;
+	//sent by clients to select the certificate, and matched against the verified peer certificate
+	const char*	serverName;
+
+	SecureOptions() : certificateFile(0x0), privateKeyFile(0x0), trustFile(0x0), serverName(0x0) { }
+};
+
+/*
+	Certificates, keys and settings shared by the secure sockets of one
+	role, loading them once instead of per connection.
+*/
+struct SecureContext
+{
+	struct Impl;
+	Impl* m_impl;
+
+	SecureContext( SecureRole::Enum role, const SecureOptions& options );
+	~SecureContext();
+
+	SecureRole::Enum Role();
+
+private:
+	SecureContext(const SecureContext&);
+	SecureContext& operator=(const SecureContext&);
+};
+
+/*
+	Encrypts a connected stream socket with kernel TLS. Handshake runs the
+	TLS 1.3 handshake in user space with OpenSSL, then installs the traffic
+	keys of both directions in the kernel: from then on the records are
+	encrypted and decrypted by the socket itself, plain Send, Receive,
+	SendFile and the asynchronous operations carry application data
+	without a user space copy. The connection never falls back to clear
+	text, the handshake fails when the kernel lacks TLS support. Servers
+	send no session tickets; post-handshake messages of other peers, like
+	tickets or key updates, make Receive fail. The connection ends with the
+	TCP stream, the application framing has to detect truncation.
+*/
+struct SecureSocket
+{
+	struct Impl;
+	Impl* m_impl;
+
+	//the socket and the context must outlive the secure socket
+	SecureSocket( Socket& socket, SecureContext& context );
+	~SecureSocket();
+
+	//blocks until the handshake completed, switching a non-blocking socket for its duration
+	void Handshake();
+	//the negotiated cipher suite, 0x0 before the handshake
+	const char* Cipher();
+	//whether the kernel of the system can take over TLS records
+	static bool Supported();
+
+private:
+	SecureSocket(const SecureSocket&);
+	SecureSocket& operator=(const SecureSocket&);
+};
+
+#endif
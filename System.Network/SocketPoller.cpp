@@ -0,0 +1,241 @@
+#include "SocketPoller.h"
+#include "NetworkImpl.h"
+#include "Threading.h"
+#include <vector>
+
+#if PLATFORM == PLATFORM_LINUX
+#include <sys/epoll.h>
+#endif
+
+namespace
+{
+	struct Registration
+	{
+		Socket* socket;
+		void*	state;
+		int		events;
+	};
+
+	SOCKET Descriptor(Socket& socket)
+	{
+		SOCKET descriptor = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->socket;
+		if( descriptor == INVALID_SOCKET ) {
+			throw SocketException("The socket is not valid.");
+		}
+		return descriptor;
+	}
+
+	#if PLATFORM == PLATFORM_LINUX
+	uint32_t ToNative(int events)
+	{
+		uint32_t native = 0;
+		if( events & PollEvents::Read )  native |= EPOLLIN | EPOLLRDHUP;
+		if( events & PollEvents::Write ) native |= EPOLLOUT;
+		return native;
+	}
+
+	int FromNative(uint32_t native)
+	{
+		int events = 0;
+		if( native & (EPOLLIN | EPOLLRDHUP | EPOLLHUP) ) events |= PollEvents::Read;
+		if( native & EPOLLOUT ) events |= PollEvents::Write;
+		if( native & (EPOLLERR | EPOLLPRI) ) events |= PollEvents::Error;
+		return events;
+	}
+	#elif PLATFORM == PLATFORM_WIN32
+	SHORT ToNative(int events)
+	{
+		SHORT native = 0;
+		if( events & PollEvents::Read )  native |= POLLRDNORM;
+		if( events & PollEvents::Write ) native |= POLLWRNORM;
+		return native;
+	}
+
+	int FromNative(SHORT native)
+	{
+		int events = 0;
+		if( native & (POLLRDNORM | POLLHUP) ) events |= PollEvents::Read;
+		if( native & POLLWRNORM ) events |= PollEvents::Write;
+		if( native & (POLLERR | POLLNVAL) ) events |= PollEvents::Error;
+		return events;
+	}
+	#endif
+}
+
+struct SocketPoller::Impl
+{
+	Mutex mutex;
+	#if PLATFORM == PLATFORM_LINUX
+	int epoll;
+	//registrations indexed by descriptor, the socket is 0x0 for unused slots
+	std::vector<Registration> registrations;
+	std::vector<epoll_event>  events;
+	#elif PLATFORM == PLATFORM_WIN32
+	//registrations parallel to the polled descriptors
+	std::vector<WSAPOLLFD>	  descriptors;
+	std::vector<Registration> registrations;
+	#endif
+};
+
+SocketPoller::SocketPoller()
+{
+	m_impl = new Impl();
+	#if PLATFORM == PLATFORM_LINUX
+	m_impl->epoll = epoll_create1(EPOLL_CLOEXEC);
+	if( m_impl->epoll == SOCKET_ERROR ) {
+		int errorCode = errno;
+		delete m_impl;
+		throw SocketException(resolveError(errorCode));
+	}
+	#endif
+}
+
+SocketPoller::~SocketPoller()
+{
+	#if PLATFORM == PLATFORM_LINUX
+	close(m_impl->epoll);
+	#endif
+	delete m_impl;
+}
+
+void SocketPoller::Add( Socket& socket, int events, void* state )
+{
+	SOCKET descriptor = Descriptor(socket);
+	Registration registration = { &socket, state, events };
+
+	ScopedLock lock(m_impl->mutex);
+	#if PLATFORM == PLATFORM_LINUX
+	epoll_event event;
+	event.events = ToNative(events);
+	event.data.fd = descriptor;
+	if( epoll_ctl(m_impl->epoll, EPOLL_CTL_ADD, descriptor, &event) != 0 ) {
+		throw SocketException(resolveError(errno));
+	}
+	if( m_impl->registrations.size() <= (size_t)descriptor ) {
+		Registration unused = { 0x0, 0x0, 0 };
+		m_impl->registrations.resize(descriptor + 1, unused);
+	}
+	m_impl->registrations[descriptor] = registration;
+	#elif PLATFORM == PLATFORM_WIN32
+	for( size_t i = 0; i < m_impl->descriptors.size(); i++ ) {
+		if( m_impl->descriptors[i].fd == descriptor ) {
+			throw SocketException("The socket is already registered with the poller.");
+		}
+	}
+	WSAPOLLFD pollDescriptor;
+	pollDescriptor.fd = descriptor;
+	pollDescriptor.events = ToNative(events);
+	pollDescriptor.revents = 0;
+	m_impl->descriptors.push_back(pollDescriptor);
+	m_impl->registrations.push_back(registration);
+	#endif
+}
+
+void SocketPoller::Modify( Socket& socket, int events, void* state )
+{
+	SOCKET descriptor = Descriptor(socket);
+	Registration registration = { &socket, state, events };
+
+	ScopedLock lock(m_impl->mutex);
+	#if PLATFORM == PLATFORM_LINUX
+	epoll_event event;
+	event.events = ToNative(events);
+	event.data.fd = descriptor;
+	if( epoll_ctl(m_impl->epoll, EPOLL_CTL_MOD, descriptor, &event) != 0 ) {
+		throw SocketException(resolveError(errno));
+	}
+	m_impl->registrations[descriptor] = registration;
+	#elif PLATFORM == PLATFORM_WIN32
+	for( size_t i = 0; i < m_impl->descriptors.size(); i++ ) {
+		if( m_impl->descriptors[i].fd == descriptor ) {
+			m_impl->descriptors[i].events = ToNative(events);
+			m_impl->registrations[i] = registration;
+			return;
+		}
+	}
+	throw SocketException("The socket is not registered with the poller.");
+	#endif
+}
+
+void SocketPoller::Remove( Socket& socket )
+{
+	SOCKET descriptor = Descriptor(socket);
+
+	ScopedLock lock(m_impl->mutex);
+	#if PLATFORM == PLATFORM_LINUX
+	epoll_ctl(m_impl->epoll, EPOLL_CTL_DEL, descriptor, 0x0);
+	if( (size_t)descriptor < m_impl->registrations.size() ) {
+		m_impl->registrations[descriptor].socket = 0x0;
+	}
+	#elif PLATFORM == PLATFORM_WIN32
+	for( size_t i = 0; i < m_impl->descriptors.size(); i++ ) {
+		if( m_impl->descriptors[i].fd == descriptor ) {
+			m_impl->descriptors[i] = m_impl->descriptors.back();
+			m_impl->registrations[i] = m_impl->registrations.back();
+			m_impl->descriptors.pop_back();
+			m_impl->registrations.pop_back();
+			return;
+		}
+	}
+	#endif
+}
+
+int SocketPoller::Wait( SocketReadiness* ready, int capacity, int milliSeconds )
+{
+	if( capacity < 1 ) {
+		throw SocketException("Argument capacity is out of range.");
+	}
+
+	int count = 0;
+	#if PLATFORM == PLATFORM_LINUX
+	//a single thread waits, the event buffer is reused between calls
+	if( m_impl->events.size() < (size_t)capacity ) {
+		m_impl->events.resize(capacity);
+	}
+	int num = epoll_wait(m_impl->epoll, &m_impl->events[0], capacity, milliSeconds);
+	if( num == SOCKET_ERROR ) {
+		if( errno == EINTR )
+			return 0;
+		throw SocketException(resolveError(errno));
+	}
+
+	ScopedLock lock(m_impl->mutex);
+	for( int i = 0; i < num; i++ ) {
+		SOCKET descriptor = m_impl->events[i].data.fd;
+		//removed while the events were collected
+		if( (size_t)descriptor >= m_impl->registrations.size() || m_impl->registrations[descriptor].socket == 0x0 )
+			continue;
+		Registration& registration = m_impl->registrations[descriptor];
+		ready[count].socket = registration.socket;
+		ready[count].state = registration.state;
+		ready[count].events = FromNative(m_impl->events[i].events);
+		count++;
+	}
+	#elif PLATFORM == PLATFORM_WIN32
+	std::vector<WSAPOLLFD> descriptors;
+	std::vector<Registration> registrations;
+	{
+		ScopedLock lock(m_impl->mutex);
+		descriptors = m_impl->descriptors;
+		registrations = m_impl->registrations;
+	}
+	if( descriptors.empty() == true ) {
+		Sleep(milliSeconds < 0 ? INFINITE : milliSeconds);
+		return 0;
+	}
+
+	int num = WSAPoll(&descriptors[0], (ULONG)descriptors.size(), milliSeconds);
+	if( num == SOCKET_ERROR ) {
+		throw SocketException(resolveError(WSAGetLastError()));
+	}
+	for( size_t i = 0; i < descriptors.size() && count < capacity && num > 0; i++ ) {
+		if( descriptors[i].revents == 0 )
+			continue;
+		ready[count].socket = registrations[i].socket;
+		ready[count].state = registrations[i].state;
+		ready[count].events = FromNative(descriptors[i].revents);
+		count++; num--;
+	}
+	#endif
+	return count;
+}
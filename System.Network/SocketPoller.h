@@ -0,0 +1,46 @@
+#pragma once
+#include "Network.h"
+
+namespace PollEvents
+{
+	enum Enum
+	{
+		Read  = 1,
+		Write = 2,
+		Error = 4
+	};
+}
+
+struct SocketReadiness
+{
+	Socket* socket;
+	void*	state;
+	//combination of PollEvents
+	int		events;
+};
+
+/*
+	Waits on many sockets at once. Sockets are registered once and stay
+	registered until removed or closed, each Wait returns the ready sockets
+	in a batch. Linux uses a level-triggered epoll instance, windows falls
+	back to WSAPoll over the registered set. The registered Socket objects
+	must outlive their registration and must not be moved while registered.
+*/
+struct SocketPoller
+{
+	struct Impl;
+	Impl* m_impl;
+
+	SocketPoller();
+	~SocketPoller();
+
+	void Add( Socket& socket, int events, void* state );
+	void Modify( Socket& socket, int events, void* state );
+	void Remove( Socket& socket );
+	//waits up to milliSeconds, -1 waits indefinitely, returns the number of entries written to ready
+	int  Wait( SocketReadiness* ready, int capacity, int milliSeconds );
+
+private:
+	SocketPoller(const SocketPoller&);
+	SocketPoller& operator=(const SocketPoller&);
+};
@@ -0,0 +1,225 @@
+#include "SocketWriter.h"
+#include "Threading.h"
+#include <string.h>
+#include <deque>
+
+namespace
+{
+	//slices per gathering send, well below IOV_MAX
+	const int32 MaxSlices = 64;
+}
+
+struct SocketWriter::Impl
+{
+	Socket&		socket;
+	BufferPool&	pool;
+	int32		chunkSize;
+	int32		lowWatermark;
+	int32		highWatermark;
+	Mutex		mutex;
+	//the queue starts at head in the first chunk and ends at tail in the last one
+	std::deque<uint8*> chunks;
+	int32		head;
+	int32		tail;
+	int64		queued;
+	//bytes at the front of the queue a flush is sending, they stay in place until it ended
+	int64		flushing;
+	bool		paused;
+	WatermarkCallback callback;
+	void*		state;
+
+	Impl(Socket& s, BufferPool& p) : socket(s), pool(p), head(0), tail(0), queued(0), flushing(0), paused(false), callback(0x0), state(0x0) { }
+
+	//describes the front of the queue and marks it as being flushed
+	int32 Gather(IoSlice* slices)
+	{
+		ScopedLock lock(mutex);
+		if( flushing != 0 ) {
+			throw SocketException("A flush is already in progress.");
+		}
+
+		int32 count = 0;
+		for( size_t i = 0; i < chunks.size() && count < MaxSlices; i++ ) {
+			int32 begin = i == 0 ? head : 0;
+			int32 end = i + 1 == chunks.size() ? tail : chunkSize;
+			if( end > begin ) {
+				slices[count++] = IoSlice(chunks[i] + begin, end - begin);
+				flushing += end - begin;
+			}
+		}
+		return count;
+	}
+
+	//drops length sent bytes from the front of the queue, returns whether producers were resumed
+	bool Consume(int64 length)
+	{
+		ScopedLock lock(mutex);
+		flushing = 0;
+		queued -= length;
+		while( length > 0 ) {
+			int32 end = chunks.size() == 1 ? tail : chunkSize;
+			int32 step = length < end - head ? (int32)length : end - head;
+			head += step;
+			length -= step;
+			if( head == end && chunks.size() > 1 ) {
+				pool.Release(chunks.front());
+				chunks.pop_front();
+				head = 0;
+			}
+		}
+		//an idle connection holds no chunk
+		if( queued == 0 && chunks.empty() == false ) {
+			pool.Release(chunks.front());
+			chunks.clear();
+			head = tail = 0;
+		}
+
+		if( paused == true && queued <= lowWatermark ) {
+			paused = false;
+			return true;
+		}
+		return false;
+	}
+
+	void Cancel()
+	{
+		ScopedLock lock(mutex);
+		flushing = 0;
+	}
+};
+
+SocketWriter::SocketWriter( Socket& socket, BufferPool& pool, int32 lowWatermark, int32 highWatermark )
+{
+	if( lowWatermark < 0 || highWatermark < lowWatermark ) {
+		throw SocketException("Argument lowWatermark or highWatermark is out of range.");
+	}
+
+	m_impl = new Impl(socket, pool);
+	m_impl->chunkSize = pool.BufferSize();
+	m_impl->lowWatermark = lowWatermark;
+	m_impl->highWatermark = highWatermark;
+}
+
+SocketWriter::~SocketWriter()
+{
+	for( size_t i = 0; i < m_impl->chunks.size(); i++ )
+		m_impl->pool.Release(m_impl->chunks[i]);
+	delete m_impl;
+}
+
+bool SocketWriter::Write( const uint8* buffer, int32 offset, int32 size )
+{
+	if( offset < 0 || size < 0 ) {
+		throw SocketException("Argument offset or size is out of range.");
+	}
+
+	WatermarkCallback callback = 0x0;
+	void* state = 0x0;
+	{
+		ScopedLock lock(m_impl->mutex);
+		const uint8* source = buffer + offset;
+		int32 left = size;
+		while( left > 0 ) {
+			if( m_impl->chunks.empty() == true || m_impl->tail == m_impl->chunkSize ) {
+				m_impl->chunks.push_back(m_impl->pool.Acquire());
+				m_impl->tail = 0;
+			}
+			int32 step = m_impl->chunkSize - m_impl->tail < left ? m_impl->chunkSize - m_impl->tail : left;
+			memcpy(m_impl->chunks.back() + m_impl->tail, source, step);
+			m_impl->tail += step;
+			source += step;
+			left -= step;
+		}
+		m_impl->queued += size;
+
+		if( m_impl->paused == false && m_impl->queued > m_impl->highWatermark ) {
+			m_impl->paused = true;
+			callback = m_impl->callback;
+			state = m_impl->state;
+		} else if( m_impl->paused == false ) {
+			return true;
+		}
+	}
+	if( callback != 0x0 )
+		callback(*this, true, state);
+	return false;
+}
+
+int  SocketWriter::Flush()
+{
+	IoSlice slices[MaxSlices];
+	int32 count = m_impl->Gather(slices);
+	if( count == 0 )
+		return 0;
+
+	SocketError::Enum error = SocketError::Success;
+	int length = m_impl->socket.Send(slices, count, error);
+	if( error != SocketError::Success ) {
+		m_impl->Cancel();
+		if( error == SocketError::WouldBlock )
+			return 0;
+		throw SocketException(SocketError::Message(error));
+	}
+	Resume(m_impl->Consume(length));
+	return length;
+}
+
+IAsyncResult* SocketWriter::BeginFlush( AsyncCallback callback, void* state, SocketIOManager& manager/* = SocketIOManager::Default()*/ )
+{
+	IoSlice slices[MaxSlices];
+	int32 count = m_impl->Gather(slices);
+	try {
+		return m_impl->socket.BeginSend(slices, count, callback, state, manager);
+	} catch( SocketException& ) {
+		m_impl->Cancel();
+		throw;
+	}
+}
+
+int  SocketWriter::EndFlush( IAsyncResult* result )
+{
+	int length = 0;
+	try {
+		length = m_impl->socket.EndSend(result);
+	} catch( SocketException& ) {
+		m_impl->Cancel();
+		throw;
+	}
+	Resume(m_impl->Consume(length));
+	return length;
+}
+
+int64 SocketWriter::Queued()
+{
+	ScopedLock lock(m_impl->mutex);
+	return m_impl->queued;
+}
+
+bool SocketWriter::Paused()
+{
+	ScopedLock lock(m_impl->mutex);
+	return m_impl->paused;
+}
+
+void SocketWriter::Watermark( WatermarkCallback callback, void* state )
+{
+	ScopedLock lock(m_impl->mutex);
+	m_impl->callback = callback;
+	m_impl->state = state;
+}
+
+void SocketWriter::Resume( bool resumed )
+{
+	if( resumed == false )
+		return;
+
+	WatermarkCallback callback = 0x0;
+	void* state = 0x0;
+	{
+		ScopedLock lock(m_impl->mutex);
+		callback = m_impl->callback;
+		state = m_impl->state;
+	}
+	if( callback != 0x0 )
+		callback(*this, false, state);
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "Network.h"
+#include "BufferPool.h"
+
+struct SocketWriter;
+
+//invoked when producers are paused because the queue grew past the high watermark, and
+//when they are resumed once it drained to the low watermark; runs on the thread that
+//crossed the watermark, outside the writer lock
+typedef void (*WatermarkCallback)( SocketWriter& writer, bool paused, void* state );
+
+/*
+	Buffers the writes to a socket. Small writes are copied into chunks of
+	the pool and the queue is sent with a single gathering send per flush,
+	so a burst of responses costs one call instead of one per response.
+	Partial sends keep the rest queued for the next flush. Non-blocking
+	sockets flush once they poll writable, asynchronous ones with
+	BeginFlush/EndFlush, at most one flush may be outstanding. Writes never
+	block nor send: once more than highWatermark bytes are queued producers
+	are told to pause, until a flush brings the queue down to lowWatermark.
+	Write may be called from any thread while a flush is in progress.
+*/
+struct SocketWriter
+{
+	struct Impl;
+	Impl* m_impl;
+
+	//chunks of the pool are only held while they have data queued, the socket and the
+	//pool must outlive the writer
+	SocketWriter( Socket& socket, BufferPool& pool, int32 lowWatermark, int32 highWatermark );
+	~SocketWriter();
+
+	//queues a copy of the bytes, returns false while producers are paused
+	bool Write( const uint8* buffer, int32 offset, int32 size );
+	//sends the queue with a single call and returns the bytes sent, 0 when a non-blocking socket was not ready
+	int  Flush();
+	//sends the queue as it is now, EndFlush returns once all of it was sent
+	IAsyncResult* BeginFlush( AsyncCallback callback, void* state, SocketIOManager& manager = SocketIOManager::Default() );
+	int  EndFlush( IAsyncResult* result );
+	//bytes written and not yet sent
+	int64 Queued();
+	bool Paused();
+	void Watermark( WatermarkCallback callback, void* state );
+
+private:
+	//tells the producers once a flush brought the queue down to the low watermark
+	void Resume( bool resumed );
+	SocketWriter(const SocketWriter&);
+	SocketWriter& operator=(const SocketWriter&);
+};
@@ -0,0 +1,170 @@
+#pragma once
+#include "Config.h"
+
+#if PLATFORM == PLATFORM_WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#endif
+
+struct Mutex
+{
+	#if PLATFORM == PLATFORM_WIN32
+	CRITICAL_SECTION handle;
+	Mutex()				{ InitializeCriticalSection(&handle); }
+	~Mutex()			{ DeleteCriticalSection(&handle); }
+	void Lock()			{ EnterCriticalSection(&handle); }
+	void Unlock()		{ LeaveCriticalSection(&handle); }
+	#else
+	pthread_mutex_t handle;
+	Mutex()				{ pthread_mutex_init(&handle, 0); }
+	~Mutex()			{ pthread_mutex_destroy(&handle); }
+	void Lock()			{ pthread_mutex_lock(&handle); }
+	void Unlock()		{ pthread_mutex_unlock(&handle); }
+	#endif
+
+private:
+	Mutex(const Mutex&);
+	Mutex& operator=(const Mutex&);
+};
+
+struct ScopedLock
+{
+	Mutex& mutex;
+	ScopedLock(Mutex& m) : mutex(m)	{ mutex.Lock(); }
+	~ScopedLock()						{ mutex.Unlock(); }
+
+private:
+	ScopedLock(const ScopedLock&);
+	ScopedLock& operator=(const ScopedLock&);
+};
+
+struct Condition
+{
+	#if PLATFORM == PLATFORM_WIN32
+	CONDITION_VARIABLE handle;
+	Condition()						{ InitializeConditionVariable(&handle); }
+	~Condition()					{ }
+	void Wait(Mutex& mutex)			{ SleepConditionVariableCS(&handle, &mutex.handle, INFINITE); }
+	//returns false when the timeout elapsed
+	bool Wait(Mutex& mutex, int milliSeconds)
+	{
+		return SleepConditionVariableCS(&handle, &mutex.handle, milliSeconds) != 0;
+	}
+	void Signal()					{ WakeConditionVariable(&handle); }
+	void Broadcast()				{ WakeAllConditionVariable(&handle); }
+	#else
+	pthread_cond_t handle;
+	Condition()						{ pthread_cond_init(&handle, 0); }
+	~Condition()					{ pthread_cond_destroy(&handle); }
+	void Wait(Mutex& mutex)			{ pthread_cond_wait(&handle, &mutex.handle); }
+	//returns false when the timeout elapsed
+	bool Wait(Mutex& mutex, int milliSeconds)
+	{
+		timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += milliSeconds / 1000;
+		deadline.tv_nsec += (milliSeconds % 1000) * 1000000L;
+		if( deadline.tv_nsec >= 1000000000L ) {
+			deadline.tv_sec += 1;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		return pthread_cond_timedwait(&handle, &mutex.handle, &deadline) != ETIMEDOUT;
+	}
+	void Signal()					{ pthread_cond_signal(&handle); }
+	void Broadcast()				{ pthread_cond_broadcast(&handle); }
+	#endif
+
+private:
+	Condition(const Condition&);
+	Condition& operator=(const Condition&);
+};
+
+struct Thread
+{
+	typedef void (*Function)(void* argument);
+	Function function;
+	void*	 argument;
+
+	#if PLATFORM == PLATFORM_WIN32
+	HANDLE handle;
+	Thread() : function(0x0), argument(0x0), handle(0x0) { }
+	bool Start(Function f, void* a)
+	{
+		function = f; argument = a;
+		handle = CreateThread(0x0, 0, &Thread::Run, this, 0, 0x0);
+		return handle != 0x0;
+	}
+	void Join()
+	{
+		if( handle != 0x0 ) {
+			WaitForSingleObject(handle, INFINITE);
+			CloseHandle(handle);
+			handle = 0x0;
+		}
+	}
+	static DWORD WINAPI Run(LPVOID thread)
+	{
+		reinterpret_cast<Thread*>(thread)->function(reinterpret_cast<Thread*>(thread)->argument);
+		return 0;
+	}
+	#else
+	pthread_t handle;
+	bool	  started;
+	Thread() : function(0x0), argument(0x0), started(false) { }
+	bool Start(Function f, void* a)
+	{
+		function = f; argument = a;
+		started = pthread_create(&handle, 0x0, &Thread::Run, this) == 0;
+		return started;
+	}
+	void Join()
+	{
+		if( started == true ) {
+			pthread_join(handle, 0x0);
+			started = false;
+		}
+	}
+	static void* Run(void* thread)
+	{
+		reinterpret_cast<Thread*>(thread)->function(reinterpret_cast<Thread*>(thread)->argument);
+		return 0x0;
+	}
+	#endif
+
+private:
+	Thread(const Thread&);
+	Thread& operator=(const Thread&);
+};
+
+//milliseconds of a monotonic clock, for deadlines that must not follow wall clock adjustments
+inline uint64 Milliseconds()
+{
+	#if PLATFORM == PLATFORM_WIN32
+	return GetTickCount64();
+	#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+	#endif
+}
+
+//nanoseconds of a monotonic high resolution clock, for timing short intervals
+inline uint64 Nanoseconds()
+{
+	#if PLATFORM == PLATFORM_WIN32
+	LARGE_INTEGER frequency, now;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&now);
+	return (uint64)(now.QuadPart / frequency.QuadPart) * 1000000000 + (uint64)(now.QuadPart % frequency.QuadPart) * 1000000000 / frequency.QuadPart;
+	#else
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64)now.tv_sec * 1000000000 + now.tv_nsec;
+	#endif
+}
@@ -0,0 +1,187 @@
+#include "TimerWheel.h"
+
+#if PLATFORM == PLATFORM_WIN32
+#include <intrin.h>
+#endif
+
+namespace
+{
+	const uint64 SlotMask = TimerWheel::Slots - 1;
+
+	//index of the lowest set bit, value must not be 0
+	int LowestBit(uint64 value)
+	{
+		#if PLATFORM == PLATFORM_WIN32
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return (int)index;
+		#else
+		return __builtin_ctzll(value);
+		#endif
+	}
+
+	uint64 RotateRight(uint64 value, int count)
+	{
+		return count == 0 ? value : (value >> count) | (value << (64 - count));
+	}
+
+	void Unlink(TimerWheel::Timer* timer)
+	{
+		timer->prev->next = timer->next;
+		timer->next->prev = timer->prev;
+		timer->next = 0x0;
+		timer->prev = 0x0;
+	}
+}
+
+TimerWheel::TimerWheel(uint64 now) : current(now), count(0)
+{
+	for( int i = 0; i < Levels; i++ )
+		occupied[i] = 0;
+	for( int i = 0; i < Levels * Slots; i++ ) {
+		slots[i].next = &slots[i];
+		slots[i].prev = &slots[i];
+	}
+}
+
+//files the timer no earlier than the tick earliest
+void TimerWheel::Insert(Timer* timer, uint64 earliest)
+{
+	//a level holds the timers due before the level above comes around once
+	uint64 due = timer->deadline < earliest ? earliest : timer->deadline;
+	uint64 delta = due - current;
+	int level = 0;
+	while( level < Levels - 1 && delta >= ((uint64)1 << (SlotBits * (level + 1))) )
+		level++;
+	if( delta >= ((uint64)1 << (SlotBits * Levels)) )
+		due = current + ((uint64)1 << (SlotBits * Levels)) - 1;
+
+	int index = (int)((due >> (SlotBits * level)) & SlotMask);
+	Timer* head = &slots[level * Slots + index];
+	timer->slot = level * Slots + index;
+	timer->prev = head->prev;
+	timer->next = head;
+	head->prev->next = timer;
+	head->prev = timer;
+	occupied[level] |= (uint64)1 << index;
+}
+
+void TimerWheel::Schedule(Timer* timer, uint64 deadline)
+{
+	if( timer->Scheduled() == true )
+		Cancel(timer);
+	timer->deadline = deadline;
+	//the slot of the current tick was drained already
+	Insert(timer, current + 1);
+	count++;
+}
+
+void TimerWheel::Cancel(Timer* timer)
+{
+	if( timer->Scheduled() == false )
+		return;
+
+	Timer* head = &slots[timer->slot];
+	Unlink(timer);
+	if( head->next == head )
+		occupied[timer->slot / Slots] &= ~((uint64)1 << (timer->slot % Slots));
+	count--;
+}
+
+//moves the timers of the level's current slot to the levels below, the slot
+//of the current tick on the lowest level is drained right after
+void TimerWheel::Refile(int level)
+{
+	int index = (int)((current >> (SlotBits * level)) & SlotMask);
+	Timer* head = &slots[level * Slots + index];
+	occupied[level] &= ~((uint64)1 << index);
+
+	Timer* timer = head->next;
+	head->next = head;
+	head->prev = head;
+	while( timer != head ) {
+		Timer* next = timer->next;
+		Insert(timer, current);
+		timer = next;
+	}
+}
+
+void TimerWheel::Advance(uint64 now, std::vector<Timer*>& expired)
+{
+	while( current < now ) {
+		if( count == 0 ) {
+			current = now;
+			break;
+		}
+		if( occupied[0] == 0 ) {
+			//nothing is due before the lowest level comes around
+			uint64 last = current | SlotMask;
+			if( last >= now ) {
+				current = now;
+				break;
+			}
+			current = last;
+		}
+
+		current++;
+		if( (current & SlotMask) == 0 ) {
+			int level = 1;
+			while( level < Levels - 1 && ((current >> (SlotBits * level)) & SlotMask) == 0 )
+				level++;
+			for( ; level > 0; level-- )
+				Refile(level);
+		}
+
+		int index = (int)(current & SlotMask);
+		Timer* head = &slots[index];
+		while( head->next != head ) {
+			Timer* timer = head->next;
+			Unlink(timer);
+			count--;
+			expired.push_back(timer);
+		}
+		occupied[0] &= ~((uint64)1 << index);
+	}
+}
+
+int TimerWheel::Timeout(uint64 now)
+{
+	if( count == 0 )
+		return -1;
+
+	//the earliest tick at which a level reaches an occupied slot
+	uint64 next = (uint64)-1;
+	for( int level = 0; level < Levels; level++ ) {
+		if( occupied[level] == 0 )
+			continue;
+		uint64 position = current >> (SlotBits * level);
+		uint64 ahead = RotateRight(occupied[level], (int)((position + 1) & SlotMask));
+		uint64 tick = (position + LowestBit(ahead) + 1) << (SlotBits * level);
+		if( tick < next )
+			next = tick;
+	}
+
+	if( next <= now )
+		return 0;
+	return next - now > 0x7fffffff ? 0x7fffffff : (int)(next - now);
+}
+
+void TimerWheel::Clear(std::vector<Timer*>& timers)
+{
+	for( int i = 0; i < Levels * Slots; i++ ) {
+		Timer* head = &slots[i];
+		while( head->next != head ) {
+			Timer* timer = head->next;
+			Unlink(timer);
+			timers.push_back(timer);
+		}
+	}
+	for( int i = 0; i < Levels; i++ )
+		occupied[i] = 0;
+	count = 0;
+}
+
+int32 TimerWheel::Count()
+{
+	return count;
+}
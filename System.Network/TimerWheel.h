@@ -0,0 +1,57 @@
+#pragma once
+#include "Config.h"
+#include <vector>
+
+/*
+	Hierarchical timing wheel with millisecond ticks. Four levels of 64
+	slots cover deadlines up to 2^24 milliseconds (about 4.6 hours) ahead,
+	later ones wait in the top level and are filed again as it comes
+	around. Timers are intrusive list nodes, scheduling and cancelling are
+	O(1), advancing costs a constant per elapsed tick plus moving the timers
+	of a slot one level down when it comes due. The wheel does no locking,
+	its owner serialises access.
+*/
+struct TimerWheel
+{
+	struct Timer
+	{
+		Timer*	next;
+		Timer*	prev;
+		uint64	deadline;
+		int32	slot;
+		//what the timer is for and whom it belongs to, left to the owner
+		int32	kind;
+		void*	context;
+		Timer() : next(0x0), prev(0x0), deadline(0), slot(0), kind(0), context(0x0) { }
+		bool Scheduled() const	{ return next != 0x0; }
+	};
+
+	enum { Levels = 4, SlotBits = 6, Slots = 1 << SlotBits };
+
+	TimerWheel(uint64 now);
+
+	//schedules the timer to expire at deadline, moving it when it was scheduled already
+	void  Schedule(Timer* timer, uint64 deadline);
+	void  Cancel(Timer* timer);
+	//advances the wheel to now and appends the timers that expired
+	void  Advance(uint64 now, std::vector<Timer*>& expired);
+	//milliseconds until the wheel has to be advanced again, -1 when no timer is scheduled
+	int   Timeout(uint64 now);
+	//cancels every timer and appends it
+	void  Clear(std::vector<Timer*>& timers);
+	int32 Count();
+
+private:
+	void Insert(Timer* timer, uint64 earliest);
+	void Refile(int level);
+
+	uint64	current;
+	int32	count;
+	//slots with at least one timer, per level
+	uint64	occupied[Levels];
+	//list heads, linked to themselves while the slot is empty
+	Timer	slots[Levels * Slots];
+
+	TimerWheel(const TimerWheel&);
+	TimerWheel& operator=(const TimerWheel&);
+};
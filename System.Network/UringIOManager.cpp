@@ -0,0 +1,1157 @@
+#include "UringIOManager.h"
+
+#if PLATFORM == PLATFORM_LINUX
+#include "AsyncResult.h"
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+namespace
+{
+	const unsigned	RingEntries = 1024;
+	const unsigned	FileSlots	= 65536;
+	const uint16	BufferGroup = 0;
+
+	//low bits of the user_data identify the completion
+	enum Tag
+	{
+		TagOperation= 0,
+		TagReceive	= 1,
+		TagWakeup	= 2,
+		TagIgnore	= 3
+	};
+
+	int UringSetup(unsigned entries, io_uring_params* params)
+	{
+		return (int)syscall(__NR_io_uring_setup, entries, params);
+	}
+
+	int UringEnter(int ring, unsigned submit, unsigned complete, unsigned flags)
+	{
+		return (int)syscall(__NR_io_uring_enter, ring, submit, complete, flags, 0x0, 0);
+	}
+
+	//waits for a completion for at most milliSeconds, -1 waits indefinitely
+	int UringWait(int ring, unsigned submit, int milliSeconds)
+	{
+		if( milliSeconds < 0 )
+			return UringEnter(ring, submit, 1, IORING_ENTER_GETEVENTS);
+
+		__kernel_timespec timeout;
+		timeout.tv_sec = milliSeconds / 1000;
+		timeout.tv_nsec = (milliSeconds % 1000) * 1000000LL;
+		io_uring_getevents_arg argument;
+		memset(&argument, 0, sizeof(argument));
+		argument.ts = (uint64)&timeout;
+		return (int)syscall(__NR_io_uring_enter, ring, submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument, sizeof(argument));
+	}
+
+	int UringRegister(int ring, unsigned opcode, void* argument, unsigned count)
+	{
+		return (int)syscall(__NR_io_uring_register, ring, opcode, argument, count);
+	}
+
+	struct Loop;
+	struct UringAsyncResult;
+
+	//bytes of a provided buffer that were not delivered yet, the chunks of a socket are
+	//chained by buffer id through the table of its loop
+	struct Chunk
+	{
+		int32	offset;
+		int32	length;
+		int32	next;
+	};
+
+	struct Entry
+	{
+		SOCKET	socket;
+		Loop*	loop;
+		bool	fixed;
+		bool	closed;
+		bool	armed;
+		bool	sending;
+		bool	eof;
+		int		error;
+		//buffer ids of the oldest and the newest chunk, -1 while none is buffered
+		int32	firstChunk;
+		int32	lastChunk;
+		ResultQueue<SocketAsyncResult> receives;
+		ResultQueue<UringAsyncResult> sends;
+		//accepts and connects in flight
+		ResultQueue<UringAsyncResult> operations;
+		//zero-copy sends waiting for the kernel to release their buffers
+		ResultQueue<UringAsyncResult> releases;
+		//deadline timers by TimerKind and the deadline each is filed for, 0 while it is not
+		TimerWheel::Timer timers[TimerKind::Expiry];
+		uint64	due[TimerKind::Expiry];
+		int		idleTimeout;
+		//when the socket last saw a completion or an operation was begun
+		uint64	activity;
+		//of the socket while it is tracked by IOStatistics, reset when it is detached
+		SocketCounters* counters;
+		Entry(SOCKET s, Loop* l) : socket(s), loop(l), fixed(false), closed(false), armed(false), sending(false), eof(false), error(0), firstChunk(-1), lastChunk(-1), idleTimeout(0), activity(0), counters(0x0)
+		{
+			for( int i = 0; i < TimerKind::Expiry; i++ ) {
+				timers[i].kind = i;
+				timers[i].context = this;
+				due[i] = 0;
+			}
+		}
+	};
+
+	struct UringAsyncResult : SocketAsyncResult, Pooled<UringAsyncResult>
+	{
+		using Pooled<UringAsyncResult>::operator new;
+		using Pooled<UringAsyncResult>::operator delete;
+
+		Entry* entry;
+		//gathered sends are submitted as sendmsg
+		msghdr message;
+		//every byte was sent, a zero-copy send still waits for its notifications
+		bool sent;
+		//the submission was cancelled because its deadline passed
+		bool timedOut;
+		//relative expiry of a timer, read by the kernel when the timeout is issued
+		__kernel_timespec expiry;
+		UringAsyncResult(SocketIOManager& m, Entry* e, SocketOperation::Enum o, uint8* b, int32 s, AsyncCallback c, void* st)
+			: SocketAsyncResult(m, o, b, s, c, st), entry(e), sent(false), timedOut(false) { }
+	};
+
+	struct Loop
+	{
+		int			ring;
+		int			wakeup;
+		uint64		wakeupValue;
+		bool		running;
+		bool		waiting;
+		bool		signalled;
+		bool		fixedFiles;
+		Thread		thread;
+		Mutex		mutex;
+
+		void*		sqRing;
+		size_t		sqRingSize;
+		void*		cqRing;
+		size_t		cqRingSize;
+		io_uring_sqe* sqes;
+		size_t		sqesSize;
+		unsigned*	sqHead;
+		unsigned*	sqTail;
+		unsigned	sqMask;
+		unsigned	sqEntries;
+		unsigned	sqLocalTail;
+		unsigned*	cqHead;
+		unsigned*	cqTail;
+		unsigned	cqMask;
+		io_uring_cqe* cqes;
+
+		io_uring_buf_ring* bufferRing;
+		size_t		bufferRingSize;
+		uint8*		buffers;
+		size_t		buffersSize;
+		int			bufferSize;
+		int			bufferCount;
+		int			freeBuffers;
+		uint16		bufferTail;
+		//chunk of every provided buffer, indexed by buffer id
+		std::vector<Chunk> chunks;
+
+		//entries that ran out of provided buffers
+		std::vector<Entry*> starved;
+		//closed entries awaiting their final completions
+		std::set<Entry*> retired;
+		//submitted timers, completed by Destroy when the ring goes away first
+		ResultQueue<UringAsyncResult> timers;
+		//socket deadlines, the loop wakes up on its own at wake
+		TimerWheel	wheel;
+		uint64		wake;
+		uint64		now;
+		std::vector<TimerWheel::Timer*> expired;
+		//callbacks to invoke once the lock is released
+		Completions completions;
+
+		Loop() : ring(-1), wakeup(-1), wakeupValue(0), running(true), waiting(false), signalled(false), fixedFiles(false),
+			sqRing(MAP_FAILED), cqRing(MAP_FAILED), sqes((io_uring_sqe*)MAP_FAILED), bufferRing((io_uring_buf_ring*)MAP_FAILED),
+			buffers((uint8*)MAP_FAILED), freeBuffers(0), bufferTail(0), wheel(Milliseconds()), wake((uint64)-1), now(0) { }
+	};
+
+	//submission helpers, loop lock must be held
+	void Publish(Loop* loop)
+	{
+		__atomic_store_n(loop->sqTail, loop->sqLocalTail, __ATOMIC_RELEASE);
+	}
+
+	unsigned Unsubmitted(Loop* loop)
+	{
+		return loop->sqLocalTail - __atomic_load_n(loop->sqHead, __ATOMIC_ACQUIRE);
+	}
+
+	io_uring_sqe* Acquire(Loop* loop)
+	{
+		if( Unsubmitted(loop) >= loop->sqEntries ) {
+			//the queue is full, submit it from the calling thread
+			Publish(loop);
+			UringEnter(loop->ring, Unsubmitted(loop), 0, 0);
+		}
+
+		io_uring_sqe* sqe = &loop->sqes[loop->sqLocalTail & loop->sqMask];
+		memset(sqe, 0, sizeof(io_uring_sqe));
+		loop->sqLocalTail++;
+		return sqe;
+	}
+
+	void Notify(Loop* loop)
+	{
+		if( loop->waiting == true && loop->signalled == false ) {
+			uint64 value = 1;
+			loop->signalled = true;
+			if( write(loop->wakeup, &value, sizeof(value)) < 0 ) { }
+		}
+	}
+
+	void ArmWakeup(Loop* loop)
+	{
+		io_uring_sqe* sqe = Acquire(loop);
+		sqe->opcode = IORING_OP_READ;
+		sqe->fd = loop->wakeup;
+		sqe->addr = (uint64)&loop->wakeupValue;
+		sqe->len = sizeof(loop->wakeupValue);
+		sqe->user_data = TagWakeup;
+	}
+
+	void ArmReceive(Entry* entry)
+	{
+		io_uring_sqe* sqe = Acquire(entry->loop);
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = entry->socket;
+		sqe->flags = IOSQE_BUFFER_SELECT | (entry->fixed ? IOSQE_FIXED_FILE : 0);
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->buf_group = BufferGroup;
+		sqe->user_data = (uint64)entry | TagReceive;
+		entry->armed = true;
+	}
+
+	void SubmitSend(UringAsyncResult* result)
+	{
+		Entry* entry = result->entry;
+		io_uring_sqe* sqe = Acquire(entry->loop);
+		sqe->fd = entry->socket;
+		sqe->flags = entry->fixed ? IOSQE_FIXED_FILE : 0;
+		if( result->sliceCount > 0 ) {
+			memset(&result->message, 0, sizeof(result->message));
+			result->message.msg_iov = result->Pending();
+			result->message.msg_iovlen = result->PendingCount();
+			sqe->opcode = result->zeroCopy ? IORING_OP_SENDMSG_ZC : IORING_OP_SENDMSG;
+			sqe->addr = (uint64)&result->message;
+			sqe->len = 1;
+		} else {
+			sqe->opcode = result->zeroCopy ? IORING_OP_SEND_ZC : IORING_OP_SEND;
+			sqe->addr = (uint64)(result->buffer + result->transferred);
+			sqe->len = result->size - result->transferred;
+		}
+		sqe->msg_flags = MSG_NOSIGNAL;
+		sqe->user_data = (uint64)result | TagOperation;
+		entry->sending = true;
+	}
+
+	void SubmitAccept(UringAsyncResult* result)
+	{
+		Entry* entry = result->entry;
+		io_uring_sqe* sqe = Acquire(entry->loop);
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->fd = entry->socket;
+		sqe->flags = entry->fixed ? IOSQE_FIXED_FILE : 0;
+		sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+		sqe->user_data = (uint64)result | TagOperation;
+		entry->operations.Push(result);
+	}
+
+	void SubmitConnect(UringAsyncResult* result)
+	{
+		Entry* entry = result->entry;
+		io_uring_sqe* sqe = Acquire(entry->loop);
+		sqe->opcode = IORING_OP_CONNECT;
+		sqe->fd = entry->socket;
+		sqe->flags = entry->fixed ? IOSQE_FIXED_FILE : 0;
+		sqe->addr = (uint64)&result->endPoint;
+		sqe->off = sizeof(result->endPoint);
+		sqe->user_data = (uint64)result | TagOperation;
+		entry->operations.Push(result);
+	}
+
+	void SubmitCancel(Loop* loop, uint64 userData)
+	{
+		io_uring_sqe* sqe = Acquire(loop);
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		sqe->addr = userData;
+		sqe->user_data = TagIgnore;
+	}
+
+	void Recycle(Loop* loop, uint16 buffer)
+	{
+		//io_uring_buf_ring::bufs is misplaced when the flexible array is compiled as C++
+		io_uring_buf* slot = reinterpret_cast<io_uring_buf*>(loop->bufferRing) + (loop->bufferTail & (loop->bufferCount - 1));
+		slot->addr = (uint64)(loop->buffers + (size_t)buffer * loop->bufferSize);
+		slot->len = loop->bufferSize;
+		slot->bid = buffer;
+		loop->bufferTail++;
+		loop->freeBuffers++;
+		__atomic_store_n(&loop->bufferRing->tail, loop->bufferTail, __ATOMIC_RELEASE);
+
+		for( size_t i = 0; i < loop->starved.size(); i++ ) {
+			Entry* entry = loop->starved[i];
+			if( entry->closed == false && entry->armed == false )
+				ArmReceive(entry);
+		}
+		loop->starved.clear();
+	}
+
+	void PushChunk(Entry* entry, uint16 buffer, int32 length)
+	{
+		Chunk& chunk = entry->loop->chunks[buffer];
+		chunk.offset = 0;
+		chunk.length = length;
+		chunk.next = -1;
+		if( entry->lastChunk == -1 )
+			entry->firstChunk = buffer;
+		else
+			entry->loop->chunks[entry->lastChunk].next = buffer;
+		entry->lastChunk = buffer;
+	}
+
+	//unlinks the oldest chunk and hands its buffer back to the kernel
+	void DropChunk(Entry* entry)
+	{
+		Loop* loop = entry->loop;
+		uint16 buffer = (uint16)entry->firstChunk;
+		entry->firstChunk = loop->chunks[buffer].next;
+		if( entry->firstChunk == -1 )
+			entry->lastChunk = -1;
+		Recycle(loop, buffer);
+	}
+
+	//completes pending receives from the buffered chunks
+	void Deliver(Entry* entry)
+	{
+		Loop* loop = entry->loop;
+		while( entry->receives.Empty() == false ) {
+			SocketAsyncResult* result = entry->receives.Front();
+			if( entry->firstChunk != -1 ) {
+				while( result->transferred < result->size && entry->firstChunk != -1 ) {
+					Chunk& chunk = loop->chunks[entry->firstChunk];
+					int32 length = result->Fill(loop->buffers + (size_t)entry->firstChunk * loop->bufferSize + chunk.offset, chunk.length);
+					chunk.offset += length;
+					chunk.length -= length;
+					if( chunk.length == 0 )
+						DropChunk(entry);
+				}
+				entry->receives.Pop();
+				Complete(loop->completions, result, 0);
+			} else if( entry->error != 0 ) {
+				entry->receives.Pop();
+				Complete(loop->completions, result, entry->error);
+			} else if( entry->eof == true ) {
+				entry->receives.Pop();
+				Complete(loop->completions, result, 0);
+			} else {
+				return;
+			}
+		}
+	}
+
+	//frees a closed entry once the kernel no longer references it
+	void Release(Entry* entry)
+	{
+		if( entry->closed == false || entry->armed == true || entry->sending == true || entry->operations.Empty() == false || entry->releases.Empty() == false )
+			return;
+
+		Loop* loop = entry->loop;
+		while( entry->firstChunk != -1 )
+			DropChunk(entry);
+		loop->starved.erase(std::remove(loop->starved.begin(), loop->starved.end(), entry), loop->starved.end());
+		loop->retired.erase(entry);
+		delete entry;
+	}
+
+	void OnReceive(Loop* loop, Entry* entry, io_uring_cqe* cqe)
+	{
+		if( cqe->flags & IORING_CQE_F_BUFFER ) {
+			uint16 buffer = (uint16)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+			loop->freeBuffers--;
+			if( cqe->res > 0 && entry->closed == false ) {
+				PushChunk(entry, buffer, cqe->res);
+			} else {
+				Recycle(loop, buffer);
+			}
+		}
+
+		entry->activity = loop->now;
+		if( cqe->res != -ENOBUFS && cqe->res != -ECANCELED )
+			countReceive(entry->counters, cqe->res < 0 ? SOCKET_ERROR : cqe->res, cqe->res < 0 ? -cqe->res : 0);
+		bool starved = false;
+		if( cqe->res == 0 ) {
+			entry->eof = true;
+		} else if( cqe->res == -ENOBUFS ) {
+			starved = true;
+		} else if( cqe->res < 0 && cqe->res != -ECANCELED && entry->closed == false ) {
+			entry->error = -cqe->res;
+		}
+
+		if( (cqe->flags & IORING_CQE_F_MORE) == 0 ) {
+			entry->armed = false;
+			if( entry->closed == false && entry->eof == false && entry->error == 0 ) {
+				if( starved == true && loop->freeBuffers == 0 )
+					loop->starved.push_back(entry);
+				else
+					ArmReceive(entry);
+			}
+		}
+
+		if( entry->closed == true )
+			Release(entry);
+		else
+			Deliver(entry);
+	}
+
+	//completes a send unless the kernel still references its buffer
+	void FinishSend(Loop* loop, UringAsyncResult* result, int error)
+	{
+		if( result->notifications > 0 ) {
+			result->error = error;
+			result->sent = true;
+			result->entry->releases.Push(result);
+		} else {
+			Complete(loop->completions, result, error);
+		}
+	}
+
+	void OnOperation(Loop* loop, UringAsyncResult* result, io_uring_cqe* cqe)
+	{
+		if( result->operation == SocketOperation::Timer ) {
+			loop->timers.Remove(result);
+			Complete(loop->completions, result, cqe->res == -ETIME ? 0 : -cqe->res);
+			return;
+		}
+
+		Entry* entry = result->entry;
+		entry->activity = loop->now;
+		if( result->operation != SocketOperation::Send ) {
+			entry->operations.Remove(result);
+			int error = cqe->res < 0 ? -cqe->res : 0;
+			if( error == ECANCELED && result->timedOut == true )
+				error = ETIMEDOUT;
+			if( result->operation == SocketOperation::Accept && cqe->res >= 0 ) {
+				//the rest of the backlog is drained without another submission
+				result->accepted[result->acceptedCount++] = cqe->res;
+				AcceptPending(entry->socket, result);
+			}
+			Complete(loop->completions, result, error);
+			if( entry->closed == true )
+				Release(entry);
+			return;
+		}
+
+		if( cqe->flags & IORING_CQE_F_NOTIF ) {
+			//the kernel released the buffer of a zero-copy submission
+			if( --result->notifications == 0 && result->sent == true ) {
+				entry->releases.Remove(result);
+				Complete(loop->completions, result, result->error);
+				if( entry->closed == true )
+					Release(entry);
+			}
+			return;
+		}
+
+		entry->sending = false;
+		countSend(entry->counters, cqe->res < 0 ? SOCKET_ERROR : cqe->res, result->size - result->transferred, cqe->res < 0 ? -cqe->res : 0);
+		if( cqe->flags & IORING_CQE_F_MORE )
+			result->notifications++;
+		if( cqe->res < 0 ) {
+			entry->sends.Pop();
+			FinishSend(loop, result, cqe->res == -ECANCELED && result->timedOut == true ? ETIMEDOUT : -cqe->res);
+		} else {
+			result->Advance(cqe->res);
+			if( result->transferred < result->size && entry->closed == false && result->timedOut == false ) {
+				SubmitSend(result);
+				return;
+			}
+			entry->sends.Pop();
+			FinishSend(loop, result, result->transferred < result->size ? (result->timedOut == true ? ETIMEDOUT : ECANCELED) : 0);
+		}
+
+		if( entry->closed == true )
+			Release(entry);
+		else if( entry->sends.Empty() == false )
+			SubmitSend(entry->sends.Front());
+	}
+
+	//loop lock must be held
+	void Reap(Loop* loop)
+	{
+		unsigned head = *loop->cqHead;
+		unsigned tail = __atomic_load_n(loop->cqTail, __ATOMIC_ACQUIRE);
+		for( ; head != tail; head++ ) {
+			io_uring_cqe* cqe = &loop->cqes[head & loop->cqMask];
+			uint64 userData = cqe->user_data;
+			switch( userData & 3 )
+			{
+				case TagOperation:
+					OnOperation(loop, reinterpret_cast<UringAsyncResult*>(userData & ~(uint64)3), cqe);
+					break;
+				case TagReceive:
+					OnReceive(loop, reinterpret_cast<Entry*>(userData & ~(uint64)3), cqe);
+					break;
+				case TagWakeup:
+					loop->signalled = false;
+					if( loop->running == true )
+						ArmWakeup(loop);
+					break;
+			}
+		}
+		__atomic_store_n(loop->cqHead, head, __ATOMIC_RELEASE);
+	}
+
+	//hands the collected callbacks to the caller unless it is nested too deep, loop lock must be held
+	void Collect(Loop* loop, Completions& completions)
+	{
+		if( InlineDepth() < MaxInlineDepth )
+			completions.Append(loop->completions);
+		else if( loop->completions.Empty() == false )
+			Notify(loop);
+	}
+
+	//files the deadline timer of the entry unless it is filed for an earlier deadline already,
+	//the timer is not moved back when operations complete but checks what is left when it expires,
+	//loop lock must be held
+	void Arm(Entry* entry, int kind, uint64 deadline)
+	{
+		if( deadline == 0 || entry->closed == true || (entry->due[kind] != 0 && entry->due[kind] <= deadline) )
+			return;
+
+		Loop* loop = entry->loop;
+		entry->due[kind] = deadline;
+		loop->wheel.Schedule(&entry->timers[kind], deadline);
+		if( deadline < loop->wake ) {
+			loop->wake = deadline;
+			Notify(loop);
+		}
+	}
+
+	//stamps the deadline of an operation left pending, loop lock must be held
+	void Watch(UringAsyncResult* result, TimerKind::Enum kind, Socket& socket)
+	{
+		Entry* entry = result->entry;
+		Socket::Impl* impl = reinterpret_cast<Socket::Impl*>(&socket.m_impl);
+		int timeout = kind == TimerKind::Receive ? impl->receiveTimeout : impl->sendTimeout;
+		entry->idleTimeout = impl->idleTimeout;
+		if( timeout == 0 && entry->idleTimeout == 0 )
+			return;
+
+		uint64 now = Milliseconds();
+		result->deadline = DeadlineOf(timeout, now);
+		Arm(entry, kind, result->deadline);
+		entry->activity = now;
+		Arm(entry, TimerKind::Idle, DeadlineOf(entry->idleTimeout, now));
+	}
+
+	//whether the kernel holds the operation, loop lock must be held
+	bool Submitted(Entry* entry, SocketAsyncResult* result)
+	{
+		if( result->operation == SocketOperation::Receive )
+			return false;
+		if( result->operation == SocketOperation::Send )
+			return entry->sending == true && entry->sends.Front() == result;
+		return true;
+	}
+
+	//times out the operations of the queue past their deadline or all of them, the ones the kernel holds
+	//are cancelled and complete with ETIMEDOUT once the cancellation went through, returns the earliest
+	//deadline left or 0, loop lock must be held
+	template<class T> uint64 Expire(Entry* entry, ResultQueue<T>& queue, uint64 now, bool all)
+	{
+		uint64 next = 0;
+		for( T* queued = queue.Front(); queued != 0x0; ) {
+			T* following = queue.Next(queued);
+			UringAsyncResult* result = static_cast<UringAsyncResult*>(queued);
+			bool expired = all == true || (result->deadline != 0 && result->deadline <= now);
+			if( expired == false || result->timedOut == true ) {
+				if( expired == false && result->deadline != 0 && (next == 0 || result->deadline < next) )
+					next = result->deadline;
+			} else if( Submitted(entry, result) == true ) {
+				result->timedOut = true;
+				SubmitCancel(entry->loop, (uint64)result | TagOperation);
+			} else {
+				queue.Remove(queued);
+				Complete(entry->loop->completions, result, ETIMEDOUT);
+			}
+			queued = following;
+		}
+		return next;
+	}
+
+	//handles an expired deadline timer of the entry, loop lock must be held
+	void Expire(Entry* entry, int kind, uint64 now)
+	{
+		entry->due[kind] = 0;
+		if( entry->closed == true )
+			return;
+
+		uint64 next = 0;
+		if( kind == TimerKind::Idle ) {
+			if( entry->idleTimeout == 0 || (entry->receives.Empty() == true && entry->sends.Empty() == true && entry->operations.Empty() == true) )
+				return;
+			if( now >= entry->activity + entry->idleTimeout ) {
+				Expire(entry, entry->receives, now, true);
+				Expire(entry, entry->sends, now, true);
+				Expire(entry, entry->operations, now, true);
+			} else {
+				next = entry->activity + entry->idleTimeout;
+			}
+		} else {
+			//accepts and connects share a queue and are handled by either deadline
+			next = kind == TimerKind::Receive ? Expire(entry, entry->receives, now, false) : Expire(entry, entry->sends, now, false);
+			uint64 operations = Expire(entry, entry->operations, now, false);
+			if( operations != 0 && (next == 0 || operations < next) )
+				next = operations;
+		}
+		Arm(entry, kind, next);
+	}
+
+	//handles the expired deadlines, returns the milliseconds until the wheel is due again or -1,
+	//loop lock must be held
+	int ExpireTimers(Loop* loop)
+	{
+		uint64 now = Milliseconds();
+		loop->wheel.Advance(now, loop->expired);
+		for( size_t i = 0; i < loop->expired.size(); i++ )
+			Expire(reinterpret_cast<Entry*>(loop->expired[i]->context), loop->expired[i]->kind, now);
+		loop->expired.clear();
+
+		int timeout = loop->wheel.Timeout(now);
+		loop->wake = timeout < 0 ? (uint64)-1 : now + timeout;
+		return timeout;
+	}
+
+	void QueueSend(UringAsyncResult* result, Socket& socket)
+	{
+		Entry* entry = result->entry;
+		Loop* loop = entry->loop;
+		ScopedLock lock(loop->mutex);
+		entry->sends.Push(result);
+		if( entry->sending == false ) {
+			SubmitSend(result);
+			Notify(loop);
+		}
+		Watch(result, TimerKind::Send, socket);
+	}
+
+	void QueueReceive(UringAsyncResult* result, Socket& socket)
+	{
+		Entry* entry = result->entry;
+		Loop* loop = entry->loop;
+		Completions completions;
+		{
+			ScopedLock lock(loop->mutex);
+			entry->receives.Push(result);
+			//armed on the first receive so listening and connecting sockets stay untouched
+			if( entry->armed == false && entry->eof == false && entry->error == 0 ) {
+				if( loop->freeBuffers == 0 ) {
+					if( std::find(loop->starved.begin(), loop->starved.end(), entry) == loop->starved.end() )
+						loop->starved.push_back(entry);
+				} else {
+					ArmReceive(entry);
+				}
+			}
+			//delivering may recycle buffers and re-arm starved sockets
+			Deliver(entry);
+			if( entry->receives.Back() == result )
+				Watch(result, TimerKind::Receive, socket);
+			if( Unsubmitted(loop) > 0 )
+				Notify(loop);
+			Collect(loop, completions);
+		}
+		Dispatch(completions);
+	}
+
+	void Run(void* argument)
+	{
+		Loop* loop = reinterpret_cast<Loop*>(argument);
+		Completions completions;
+		ScopedLock lock(loop->mutex);
+		while( loop->running == true ) {
+			if( loop->completions.Empty() == false ) {
+				completions.Append(loop->completions);
+				loop->mutex.Unlock();
+				Dispatch(completions);
+				loop->mutex.Lock();
+				continue;
+			}
+
+			int timeout = ExpireTimers(loop);
+			if( loop->completions.Empty() == false )
+				continue;
+
+			Publish(loop);
+			unsigned submit = Unsubmitted(loop);
+			loop->waiting = true;
+
+			//everything queued since the last wakeup goes out in one call
+			loop->mutex.Unlock();
+			UringWait(loop->ring, submit, timeout);
+			loop->mutex.Lock();
+
+			loop->waiting = false;
+			loop->now = Milliseconds();
+			Reap(loop);
+		}
+	}
+
+	void Destroy(Loop* loop, Completions& completions)
+	{
+		if( loop->ring != -1 ) close(loop->ring);
+		if( loop->wakeup != -1 ) close(loop->wakeup);
+		if( loop->sqRing != MAP_FAILED ) munmap(loop->sqRing, loop->sqRingSize);
+		if( loop->cqRing != MAP_FAILED && loop->cqRing != loop->sqRing ) munmap(loop->cqRing, loop->cqRingSize);
+		if( loop->sqes != MAP_FAILED ) munmap(loop->sqes, loop->sqesSize);
+		if( loop->bufferRing != MAP_FAILED ) munmap(loop->bufferRing, loop->bufferRingSize);
+		if( loop->buffers != MAP_FAILED ) munmap(loop->buffers, loop->buffersSize);
+
+		//the ring is gone, nothing references the entries anymore
+		completions.Append(loop->completions);
+		for( std::set<Entry*>::iterator it = loop->retired.begin(); it != loop->retired.end(); ++it ) {
+			if( (*it)->sending == true ) {
+				Complete(completions, (*it)->sends.Front(), ECANCELED);
+			}
+			while( (*it)->operations.Empty() == false ) {
+				Complete(completions, (*it)->operations.Pop(), ECANCELED);
+			}
+			while( (*it)->releases.Empty() == false ) {
+				Complete(completions, (*it)->releases.Pop(), ECANCELED);
+			}
+			delete *it;
+		}
+		while( loop->timers.Empty() == false ) {
+			Complete(completions, loop->timers.Pop(), ECANCELED);
+		}
+		delete loop;
+	}
+
+	void* Map(size_t size, int ring, uint64 offset)
+	{
+		if( ring == -1 )
+			return mmap(0x0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return mmap(0x0, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring, offset);
+	}
+
+	Loop* Create(int bufferCount, int bufferSize)
+	{
+		Loop* loop = new Loop();
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		params.flags = IORING_SETUP_CQSIZE;
+		params.cq_entries = RingEntries * 8;
+		if( (loop->ring = UringSetup(RingEntries, &params)) == -1 ) {
+			int errorCode = errno;
+			Completions completions;
+			Destroy(loop, completions);
+			throw SocketException(resolveError(errorCode));
+		}
+
+		loop->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		loop->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		if( params.features & IORING_FEAT_SINGLE_MMAP ) {
+			if( loop->cqRingSize > loop->sqRingSize )
+				loop->sqRingSize = loop->cqRingSize;
+			loop->cqRingSize = loop->sqRingSize;
+		}
+		loop->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+		loop->sqRing = Map(loop->sqRingSize, loop->ring, IORING_OFF_SQ_RING);
+		loop->cqRing = (params.features & IORING_FEAT_SINGLE_MMAP) ? loop->sqRing : Map(loop->cqRingSize, loop->ring, IORING_OFF_CQ_RING);
+		loop->sqes = (io_uring_sqe*)Map(loop->sqesSize, loop->ring, IORING_OFF_SQES);
+		if( loop->sqRing == MAP_FAILED || loop->cqRing == MAP_FAILED || loop->sqes == MAP_FAILED ) {
+			int errorCode = errno;
+			Completions completions;
+			Destroy(loop, completions);
+			throw SocketException(resolveError(errorCode));
+		}
+
+		uint8* sq = (uint8*)loop->sqRing;
+		uint8* cq = (uint8*)loop->cqRing;
+		loop->sqHead = (unsigned*)(sq + params.sq_off.head);
+		loop->sqTail = (unsigned*)(sq + params.sq_off.tail);
+		loop->sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+		loop->sqEntries = params.sq_entries;
+		loop->sqLocalTail = *loop->sqTail;
+		unsigned* array = (unsigned*)(sq + params.sq_off.array);
+		for( unsigned i = 0; i < params.sq_entries; i++ )
+			array[i] = i;
+		loop->cqHead = (unsigned*)(cq + params.cq_off.head);
+		loop->cqTail = (unsigned*)(cq + params.cq_off.tail);
+		loop->cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+		loop->cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+		//sparse file table indexed by descriptor, sockets above it use plain descriptors
+		io_uring_rsrc_register files;
+		memset(&files, 0, sizeof(files));
+		files.nr = FileSlots;
+		files.flags = IORING_RSRC_REGISTER_SPARSE;
+		loop->fixedFiles = UringRegister(loop->ring, IORING_REGISTER_FILES2, &files, sizeof(files)) == 0;
+
+		loop->bufferCount = bufferCount;
+		loop->bufferSize = bufferSize;
+		loop->bufferRingSize = bufferCount * sizeof(io_uring_buf);
+		loop->buffersSize = (size_t)bufferCount * bufferSize;
+		loop->bufferRing = (io_uring_buf_ring*)Map(loop->bufferRingSize, -1, 0);
+		loop->buffers = (uint8*)Map(loop->buffersSize, -1, 0);
+		if( loop->bufferRing == MAP_FAILED || loop->buffers == MAP_FAILED ) {
+			int errorCode = errno;
+			Completions completions;
+			Destroy(loop, completions);
+			throw SocketException(resolveError(errorCode));
+		}
+
+		io_uring_buf_reg ring;
+		memset(&ring, 0, sizeof(ring));
+		ring.ring_addr = (uint64)loop->bufferRing;
+		ring.ring_entries = bufferCount;
+		ring.bgid = BufferGroup;
+		if( UringRegister(loop->ring, IORING_REGISTER_PBUF_RING, &ring, 1) != 0 ) {
+			Completions completions;
+			Destroy(loop, completions);
+			throw SocketException("Provided buffer rings are not supported by this kernel.");
+		}
+		loop->chunks.resize(bufferCount);
+		for( int i = 0; i < bufferCount; i++ )
+			Recycle(loop, (uint16)i);
+
+		if( (loop->wakeup = eventfd(0, EFD_CLOEXEC)) == -1 ) {
+			int errorCode = errno;
+			Completions completions;
+			Destroy(loop, completions);
+			throw SocketException(resolveError(errorCode));
+		}
+		ArmWakeup(loop);
+		return loop;
+	}
+}
+
+struct UringIOManager::Impl
+{
+	Mutex				mutex;
+	std::vector<Loop*>	loops;
+	//entries indexed by descriptor
+	std::vector<Entry*>	entries;
+	size_t				next;
+
+	Impl(int threads, int bufferCount, int bufferSize) : next(0)
+	{
+		if( threads < 1 ) {
+			throw SocketException("Argument threads is out of range.");
+		}
+		if( bufferCount < 1 || bufferCount > 0x8000 || (bufferCount & (bufferCount - 1)) != 0 ) {
+			throw SocketException("Argument bufferCount is out of range.");
+		}
+		if( bufferSize < 1 ) {
+			throw SocketException("Argument bufferSize is out of range.");
+		}
+
+		for( int i = 0; i < threads; i++ ) {
+			Loop* loop = 0x0;
+			try {
+				loop = Create(bufferCount, bufferSize);
+			} catch( SocketException& ) {
+				Shutdown();
+				throw;
+			}
+
+			loops.push_back(loop);
+			if( loop->thread.Start(&Run, loop) == false ) {
+				Shutdown();
+				throw SocketException("Unable to start the event loop thread.");
+			}
+		}
+	}
+
+	void Shutdown()
+	{
+		for( size_t i = 0; i < loops.size(); i++ ) {
+			Loop* loop = loops[i];
+			{
+				ScopedLock lock(loop->mutex);
+				loop->running = false;
+				loop->signalled = false;
+				loop->waiting = true;
+				Notify(loop);
+			}
+			loop->thread.Join();
+		}
+
+		Completions completions;
+		for( size_t i = 0; i < entries.size(); i++ ) {
+			if( entries[i] != 0x0 ) {
+				entries[i]->closed = true;
+				entries[i]->loop->retired.insert(entries[i]);
+				while( entries[i]->receives.Empty() == false ) {
+					Complete(completions, entries[i]->receives.Pop(), ECANCELED);
+				}
+				//the send the kernel holds is completed by Destroy
+				UringAsyncResult* send = entries[i]->sends.Front();
+				if( send != 0x0 && entries[i]->sending == true )
+					send = entries[i]->sends.Next(send);
+				for( ; send != 0x0; send = entries[i]->sends.Next(send) ) {
+					Complete(completions, send, ECANCELED);
+				}
+			}
+		}
+		entries.clear();
+
+		for( size_t i = 0; i < loops.size(); i++ ) {
+			Destroy(loops[i], completions);
+		}
+		loops.clear();
+		Dispatch(completions);
+	}
+
+	Entry* Register(Socket& socket)
+	{
+		SOCKET descriptor = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->socket;
+		if( descriptor == INVALID_SOCKET ) {
+			throw SocketException("The socket is not valid.");
+		}
+
+		SocketCounters* counters = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->counters;
+		ScopedLock lock(mutex);
+		if( (size_t)descriptor < entries.size() && entries[descriptor] != 0x0 ) {
+			Entry* entry = entries[descriptor];
+			//the socket was tracked after its first operation
+			if( entry->counters != counters ) {
+				ScopedLock loopLock(entry->loop->mutex);
+				entry->counters = counters;
+			}
+			return entry;
+		}
+
+		Entry* entry = new Entry(descriptor, loops[next++ % loops.size()]);
+		{
+			ScopedLock lock(entry->loop->mutex);
+			entry->counters = counters;
+			if( entry->loop->fixedFiles == true && (unsigned)descriptor < FileSlots ) {
+				io_uring_files_update update;
+				int value = descriptor;
+				memset(&update, 0, sizeof(update));
+				update.offset = descriptor;
+				update.fds = (uint64)&value;
+				entry->fixed = UringRegister(entry->loop->ring, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+			}
+		}
+
+		if( entries.size() <= (size_t)descriptor ) {
+			entries.resize(descriptor + 1, 0x0);
+		}
+		entries[descriptor] = entry;
+		return entry;
+	}
+};
+
+UringIOManager::UringIOManager()
+{
+	m_impl = new Impl(1, 1024, 16384);
+}
+
+UringIOManager::UringIOManager(int threads)
+{
+	m_impl = new Impl(threads, 1024, 16384);
+}
+
+UringIOManager::UringIOManager(int threads, int bufferCount, int bufferSize)
+{
+	m_impl = new Impl(threads, bufferCount, bufferSize);
+}
+
+UringIOManager::~UringIOManager()
+{
+	m_impl->Shutdown();
+	delete m_impl;
+}
+
+IAsyncResult* UringIOManager::BeginTimer( int milliSeconds, AsyncCallback callback, void* state )
+{
+	if( milliSeconds < 0 ) {
+		throw SocketException("Argument milliSeconds is out of range.");
+	}
+
+	Loop* loop = 0x0;
+	{
+		ScopedLock lock(m_impl->mutex);
+		loop = m_impl->loops[m_impl->next++ % m_impl->loops.size()];
+	}
+	UringAsyncResult* result = new UringAsyncResult(*this, 0x0, SocketOperation::Timer, 0x0, 0, callback, state);
+	result->expiry.tv_sec = milliSeconds / 1000;
+	result->expiry.tv_nsec = (milliSeconds % 1000) * 1000000LL;
+
+	ScopedLock lock(loop->mutex);
+	io_uring_sqe* sqe = Acquire(loop);
+	sqe->opcode = IORING_OP_TIMEOUT;
+	sqe->fd = -1;
+	sqe->addr = (uint64)&result->expiry;
+	sqe->len = 1;
+	sqe->user_data = (uint64)result | TagOperation;
+	loop->timers.Push(result);
+	Notify(loop);
+	return result;
+}
+
+void UringIOManager::EndTimer( IAsyncResult* result )
+{
+	SocketAsyncResult::End(result);
+}
+
+IAsyncResult* UringIOManager::BeginSend( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	UringAsyncResult* result = new UringAsyncResult(*this, entry, SocketOperation::Send, buffer + offset, size, callback, state);
+	result->zeroCopy = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->zeroCopy == 1;
+
+	QueueSend(result, socket);
+	return result;
+}
+
+IAsyncResult* UringIOManager::BeginReceive( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	UringAsyncResult* result = new UringAsyncResult(*this, entry, SocketOperation::Receive, buffer + offset, size, callback, state);
+
+	QueueReceive(result, socket);
+	return result;
+}
+
+IAsyncResult* UringIOManager::BeginSend( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	UringAsyncResult* result = new UringAsyncResult(*this, entry, SocketOperation::Send, 0x0, 0, callback, state);
+	result->Gather(slices, count);
+	result->zeroCopy = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->zeroCopy == 1;
+
+	QueueSend(result, socket);
+	return result;
+}
+
+IAsyncResult* UringIOManager::BeginReceive( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	UringAsyncResult* result = new UringAsyncResult(*this, entry, SocketOperation::Receive, 0x0, 0, callback, state);
+	result->Gather(slices, count);
+
+	QueueReceive(result, socket);
+	return result;
+}
+
+IAsyncResult* UringIOManager::BeginAccept( Socket& socket, int32 capacity, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	Loop* loop = entry->loop;
+	UringAsyncResult* result = new UringAsyncResult(*this, entry, SocketOperation::Accept, 0x0, capacity, callback, state);
+	result->Reserve(capacity);
+	//the backlog past the first connection is drained with non-blocking accepts
+	socket.Blocking(false);
+
+	ScopedLock lock(loop->mutex);
+	SubmitAccept(result);
+	Watch(result, TimerKind::Receive, socket);
+	Notify(loop);
+	return result;
+}
+
+IAsyncResult* UringIOManager::BeginConnect( Socket& socket, const IPEndPoint& endPoint, AsyncCallback callback, void* state )
+{
+	Entry* entry = m_impl->Register(socket);
+	Loop* loop = entry->loop;
+	UringAsyncResult* result = new UringAsyncResult(*this, entry, SocketOperation::Connect, 0x0, 0, callback, state);
+	memset(&result->endPoint, 0, sizeof(result->endPoint));
+	result->endPoint.sin_family = AF_INET;
+	result->endPoint.sin_addr.s_addr = (in_addr_t)endPoint.adress.adress;
+	result->endPoint.sin_port = htons(endPoint.port);
+
+	ScopedLock lock(loop->mutex);
+	SubmitConnect(result);
+	Watch(result, TimerKind::Send, socket);
+	Notify(loop);
+	return result;
+}
+
+int UringIOManager::EndSend( IAsyncResult* result )
+{
+	return SocketAsyncResult::End(result);
+}
+
+int UringIOManager::EndReceive( IAsyncResult* result )
+{
+	return SocketAsyncResult::End(result);
+}
+
+int UringIOManager::EndAccept( IAsyncResult* result, Socket* accepted )
+{
+	return SocketAsyncResult::EndAccept(result, accepted);
+}
+
+void UringIOManager::EndConnect( IAsyncResult* result )
+{
+	SocketAsyncResult::End(result);
+}
+
+void UringIOManager::Detach( Socket& socket )
+{
+	SOCKET descriptor = reinterpret_cast<Socket::Impl*>(&socket.m_impl)->socket;
+	Entry* entry = 0x0;
+	{
+		ScopedLock lock(m_impl->mutex);
+		if( descriptor == INVALID_SOCKET || (size_t)descriptor >= m_impl->entries.size() )
+			return;
+		entry = m_impl->entries[descriptor];
+		m_impl->entries[descriptor] = 0x0;
+	}
+
+	if( entry != 0x0 ) {
+		Loop* loop = entry->loop;
+		ScopedLock lock(loop->mutex);
+		entry->closed = true;
+		entry->counters = 0x0;
+		loop->retired.insert(entry);
+		for( int i = 0; i < TimerKind::Expiry; i++ )
+			loop->wheel.Cancel(&entry->timers[i]);
+
+		while( entry->receives.Empty() == false )
+			Complete(loop->completions, entry->receives.Pop(), ECANCELED);
+		while( entry->sends.Empty() == false && (entry->sending == false || entry->sends.Back() != entry->sends.Front()) ) {
+			UringAsyncResult* result = entry->sends.Back();
+			entry->sends.Remove(result);
+			Complete(loop->completions, result, ECANCELED);
+		}
+
+		if( entry->armed == true )
+			SubmitCancel(loop, (uint64)entry | TagReceive);
+		if( entry->sending == true )
+			SubmitCancel(loop, (uint64)entry->sends.Front() | TagOperation);
+		for( UringAsyncResult* result = entry->operations.Front(); result != 0x0; result = entry->operations.Next(result) )
+			SubmitCancel(loop, (uint64)result | TagOperation);
+		if( entry->fixed == true ) {
+			io_uring_files_update update;
+			int value = -1;
+			memset(&update, 0, sizeof(update));
+			update.offset = descriptor;
+			update.fds = (uint64)&value;
+			UringRegister(loop->ring, IORING_REGISTER_FILES_UPDATE, &update, 1);
+		}
+
+		Release(entry);
+		Notify(loop);
+	}
+}
+
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+#include "Network.h"
+
+#if PLATFORM == PLATFORM_LINUX
+
+/*
+	io_uring implementation of SocketIOManager. Every event-loop thread owns
+	a ring; operations queued from any thread are submitted by the loop in a
+	single io_uring_enter call per wakeup. Sockets are installed in the
+	ring's registered file table and receive through a multishot recv that
+	fills buffers from a provided-buffer ring, which BeginReceive copies out.
+*/
+struct UringIOManager : SocketIOManager
+{
+	struct Impl;
+	Impl* m_impl;
+
+	UringIOManager();
+	UringIOManager(int threads);
+	//bufferCount must be a power of two, the buffers are shared by all sockets of a loop
+	UringIOManager(int threads, int bufferCount, int bufferSize);
+	~UringIOManager();
+
+	IAsyncResult* BeginTimer( int milliSeconds, AsyncCallback callback, void* state );
+	void EndTimer( IAsyncResult* result );
+
+protected:
+	IAsyncResult* BeginSend( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state );
+	IAsyncResult* BeginReceive( Socket& socket, uint8* buffer, int32 offset, int32 size, AsyncCallback callback, void* state );
+	IAsyncResult* BeginSend( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state );
+	IAsyncResult* BeginReceive( Socket& socket, const IoSlice* slices, int32 count, AsyncCallback callback, void* state );
+	IAsyncResult* BeginAccept( Socket& socket, int32 capacity, AsyncCallback callback, void* state );
+	IAsyncResult* BeginConnect( Socket& socket, const IPEndPoint& endPoint, AsyncCallback callback, void* state );
+	int  EndSend( IAsyncResult* result );
+	int  EndReceive( IAsyncResult* result );
+	int  EndAccept( IAsyncResult* result, Socket* accepted );
+	void EndConnect( IAsyncResult* result );
+	void Detach( Socket& socket );
+
+private:
+	UringIOManager(const UringIOManager&);
+	UringIOManager& operator=(const UringIOManager&);
+};
+
+#endif